@@ -35,24 +35,30 @@ extern uint8_t fan_ctrl;       // 1 = Use one-wire sensor instead of NTC probe 1
 extern int16_t pid_out;        // Output from PID controller in E-1 %
 extern bool    pid_sw;         // Switch for pid_out
 extern int16_t pid_fx;         // Fix-value for pid_out
-char rs232_inbuf[UART_BUFLEN]; // buffer for RS232 commands
-uint8_t rs232_ptr = 0;         // index in RS232 buffer
+bool    uart_echo = true;      // true = echo every received command line
 
 extern char version[];
 
+#define I2C_ROW_ADR   (0x20) /* I2C addresses scanned per row, see i2c_scan() */
+#define EEP_ROW_ITEMS (10)   /* values sent per row, see send_eep_block() */
+
 /*-----------------------------------------------------------------------------
-  Purpose  : Scan all devices on the I2C bus
-  Variables: -
- Returns  : -
+  Purpose  : Scan all devices on the I2C bus, I2C_ROW_ADR addresses per call
+  Variables: row: the part of the bus to scan, start with 0
+ Returns  : true = more rows follow, false = this was the last row
   ---------------------------------------------------------------------------*/
-void i2c_scan(void)
+bool i2c_scan(uint8_t row)
 {
-    char    s[50]; // needed for printing to serial terminal
-    uint8_t x = 0;
-    int     i;     // Leave this as an int!
+    static uint8_t x; // number of devices found
+    char    s[10];    // needed for printing to serial terminal
+    int     i;        // Leave this as an int!
     
-    xputs("I2C: ");
-    for (i = 0x00; i < 0xff; i+=2)
+    if (row == 0)
+    {
+        xputs("I2C: ");
+        x = 0;
+    } // if
+    for (i = row * I2C_ROW_ADR; i < (row + 1) * I2C_ROW_ADR; i+=2)
     {
         if (i2c_start_bb(i) == I2C_ACK)
         {
@@ -62,44 +68,39 @@ void i2c_scan(void)
         } // if
         i2c_stop_bb();
     } // for
+    if (i < 0x100) return true;
     if (!x) xputs("-");
     xputs("\n");
+    return false;
 } // i2c_scan()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : Non-blocking RS232 command-handler via the UART
-  Variables: -
-  Returns  : [NO_ERR, ERR_CMD, ERR_NUM, ERR_I2C]
+  Purpose  : Non-blocking RS232 command-handler via the UART. The lines are
+             assembled by the UART RX interrupt, this executes one line.
+             The reply is sent one row per call: row 0 is the echo of the
+             line, the command starts at row 1. After the last row, the
+             line buffer is given back to the RX interrupt.
+  Variables: row: the row of the reply to send, start with 0
+  Returns  : [NO_ERR, ERR_CMD, ERR_NUM, CMD_MORE]
   ---------------------------------------------------------------------------*/
-uint8_t rs232_command_handler(void)
+uint8_t rs232_command_handler(uint8_t row)
 {
-  uint8_t ch;
-  static bool cmd_rcvd = 0;
+  char    *s = uart_get_line();
+  uint8_t rval;
   
-  if (!cmd_rcvd && uart_kbhit())
-  { // A new character has been received
-    ch = tolower(uart_read()); // get character as lowercase
-    uart_write(ch);
-    switch (ch)
-    {
-        case '\r': break;
-        case '\n': cmd_rcvd  = true;
-                   rs232_inbuf[rs232_ptr] = '\0';
-                   rs232_ptr = 0;
-                   break;
-        default  : if (rs232_ptr < UART_BUFLEN-1)
-                        rs232_inbuf[rs232_ptr++] = ch;
-                   break;
-    } // switch
-  } // if
-  if (cmd_rcvd)
-  {
-    cmd_rcvd = false;
-    return execute_single_command(rs232_inbuf);
+  if (s == NULL) return NO_ERR; // no command received
+  if (row == 0)
+  {   
+      if (uart_echo)
+      {   // echo the command line
+          xputs(s);
+          xputs("\n");
+      } // if
+      return CMD_MORE;
   } // if
-  else if (rs232_ptr >= UART_BUFLEN-1) 
-       rs232_ptr = 0; // Reset if Buffer full and no command received
-  return NO_ERR; // Continu if Buffer not full and no command received
+  rval = execute_single_command(s, row - 1);
+  if (rval != CMD_MORE) uart_line_done(); // RX interrupt may use the line buffer again
+  return rval;
 } // rs232_command_handler()
 
 void print_value10(int16_t x)
@@ -122,163 +123,339 @@ void print_value10(int16_t x)
 uint8_t process_string(char *s, char *s1, uint16_t *d1, uint16_t *d2)
 {
     uint8_t i = 0;
-    uint8_t len = strlen(s);
     
-    s1[0] = '\0';
-    *d1   = *d2 = 0;
-    while ((i < len) && (s[i] != ' ') && (s[i] != '=')) i++;
-    strncpy(s1,s,i); // copy command into 1st string
+    *d1 = *d2 = 0;
+    while (s[i] && (s[i] != ' ') && (s[i] != '='))
+    {   // copy command into 1st string, in the same pass
+        s1[i] = s[i];
+        i++;
+    } // while
     s1[i] = '\0';    // terminate string
-    if (i >= len) return 1; // only 1 item in command
+    if (s[i] == '\0') return 1; // only 1 item in command
     else if (s[i] == '=')
     {
         *d1 = (uint16_t)strtol(&s[i+1],NULL,10);
         return 2; // 2 items, return 2nd substring as a decimal number
     } // if
     *d1 = (uint16_t)strtol(&s[++i],NULL,16); // address in hex
-    while ((i < len) && (s[i] != ' ')) i++;  // find next space
-    if (i >= len) return 2;                  // no more data
+    while (s[i] && (s[i] != ' ')) i++;       // find next space
+    if (s[i] == '\0') return 2;              // no more data
     *d2 = (uint16_t)strtol(&s[i+1],NULL,16); // data in hex
     return 3;
 } // process_string()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : send the contents of a profile set or the parameters to the UART.
-  Variables: -
-  Returns  : -
+  Purpose  : send the contents of a profile set or the parameters to the UART,
+             EEP_ROW_ITEMS values per call. All rows together are one line.
+  Variables: num: the profile [0..NO_OF_PROFILES-1] or NO_OF_PROFILES for 
+                  the parameters
+             row: the row to send, start with 0
+  Returns  : true = more rows follow, false = this was the last row
   ---------------------------------------------------------------------------*/
-void send_eep_block(uint8_t num)
+bool send_eep_block(uint8_t num, uint8_t row)
 {
-    char     s[35], s1[10];
+    char     s[10];
     uint8_t  i,maxi,adr;
     uint16_t val;
 	
     maxi = ((num < NO_OF_PROFILES) ? PROFILE_SIZE : MENU_SIZE);
-    sprintf(s,"p%d ",num);
-    for (i = 0; i < maxi; i++)
+    if (row == 0)
+    {
+        sprintf(s,"p%d ",num);
+        xputs(s);
+    } // if
+    for (i = row * EEP_ROW_ITEMS; (i < maxi) && (i < (row + 1) * EEP_ROW_ITEMS); i++)
     {
        adr = MI_CI_TO_EEADR(num,i);
        val = eeprom_read_config(adr);
-       sprintf(s1,"%d",val);
-       if (i < maxi-1) strcat(s1,",");
-       strcat(s,s1);
-       if (strlen(s) > 25) 
-       {
-           xputs(s);
-           s[0] = '\0';
-       } // if
+       sprintf(s,"%d",val);
+       if (i < maxi-1) strcat(s,",");
+       xputs(s);
     } // for i
-    strcat(s,"\n");
-    xputs(s);
+    if (i < maxi) return true;
+    xputs("\n");
+    return false;
 } // send_eep_block()
 
 /*-----------------------------------------------------------------------------
-  Purpose: interpret commands which are received via the UART:
-   - O0/O1        : O0: select NTC temp. O1: select DS18B20 temp.
-   - S0           : Display version number
-     S1           : List all connected I2C devices  
-     S2           : List all tasks
-     S3           : Show DS18B20 temperature
+  Purpose  : The command handlers, called by execute_single_command() via
+             cmd_list[]. A handler sends at most REPLY_ROW_MAX bytes per
+             call. A longer reply is sent in rows: the handler returns 
+             CMD_MORE and is called again with the next row, only handlers
+             that do not write anything may do this.
+             All handlers have the same parameters:
+  Variables: num  : the number after a 1-letter command, e.g. 3 for 'p3'
+             count: number of items in the command, see process_string()
+             d1,d2: the 2nd and 3rd item of the command
+             row  : the row of the reply to send, 0 for the first call
+  Returns  : [NO_ERR, ERR_CMD, ERR_NUM, CMD_MORE]
+  ---------------------------------------------------------------------------*/
+uint8_t cmd_sp(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // setpoint read/write
+    if (count > 1)
+    {   // write setpoint
+        setpoint = d1;
+        eeprom_write_config(EEADR_MENU_ITEM(SP), setpoint);
+    } // if
+    xputs("SP=");
+    print_value10(setpoint);
+    return NO_ERR;
+} // cmd_sp()
+
+uint8_t cmd_pid(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // pid-output read/write
+    if (count > 1)
+    {    // write pid-output
+        if (d1 > 1000)
+        {   // reset switch, auto-run pid controller
+            pid_fx = 0;
+            pid_sw = false;
+        } // if
+        else
+        {   // fix pid-output to a fixed value
+            pid_fx = d1;
+            pid_sw = true;
+        } // else
+    } // if
+    xputs("pid_out=");
+    print_value10(pid_fx);
+    return NO_ERR;
+} // cmd_pid()
+
+uint8_t cmd_rb(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Read Byte
+    char s[20];
+    
+    sprintf(s,"0x%X (%d)\n",*(uint8_t *)(uintptr_t)d1,*(uint8_t *)(uintptr_t)d1);
+    xputs(s);
+    return NO_ERR;
+} // cmd_rb()
+
+uint8_t cmd_rw(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Read Word
+    char s[20];
+    
+    sprintf(s,"%X (%d)\n",*(uint16_t *)(uintptr_t)d1,*(uint16_t *)(uintptr_t)d1);
+    xputs(s);
+    return NO_ERR;
+} // cmd_rw()
+
+uint8_t cmd_wb(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Write Byte
+    *(uint8_t *)(uintptr_t)d1 = (uint8_t)d2;
+    return NO_ERR;
+} // cmd_wb()
+
+uint8_t cmd_ww(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Write Word
+    *(uint16_t *)(uintptr_t)d1 = d2;
+    return NO_ERR;
+} // cmd_ww()
+
+uint8_t cmd_te(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Enable task, d1 is the task-handle (see s2)
+    return (enable_task((uint8_t)d1) != NO_ERR) ? ERR_NUM : NO_ERR;
+} // cmd_te()
+
+uint8_t cmd_td(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Disable task, d1 is the task-handle (see s2)
+    return (disable_task((uint8_t)d1) != NO_ERR) ? ERR_NUM : NO_ERR;
+} // cmd_td()
+
+uint8_t cmd_e(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Echo of command lines off (e0) or on (e1)
+    uart_echo = (num > 0);
+    return NO_ERR;
+} // cmd_e()
+
+uint8_t cmd_p(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Request to send parameters or one of the profiles
+    if (num <= NO_OF_PROFILES)
+    {  // send Profile or parameters to the ESP8266 web-server
+       if (send_eep_block(num, row)) return CMD_MORE;
+    } // if
+    return NO_ERR;
+} // cmd_p()
+
+uint8_t cmd_v(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // A parameter of profile data-item has changed in the ESP8266 web-server
+    if (count > 1) eeprom_write_config(num,d1); // 'vx' without '=y' is ignored
+    return NO_ERR;
+} // cmd_v()
+
+uint8_t cmd_s0(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Revision number
+    xputs(version);
+    return NO_ERR;
+} // cmd_s0()
+
+uint8_t cmd_s1(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List all I2C devices
+    return i2c_scan(row) ? CMD_MORE : NO_ERR;
+} // cmd_s1()
+
+uint8_t cmd_s2(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List all tasks
+    return list_all_tasks(row) ? CMD_MORE : NO_ERR;
+} // cmd_s2()
+
+uint8_t cmd_s3(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // DS18B20 temperature
+    char s[30];
+    
+    sprintf(s,"ds18b20_read():%d, T=",(uint16_t)temp1_ow_err);
+    xputs(s);
+    print_value10(temp1_ow_10);
+    return NO_ERR;
+} // cmd_s3()
+
+uint8_t cmd_s4(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Show CPU load
+    print_cpu_load();
+    return NO_ERR;
+} // cmd_s4()
+
+uint8_t cmd_s5(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List drift and missed releases of all tasks
+    return list_task_timing(row) ? CMD_MORE : NO_ERR;
+} // cmd_s5()
+
+uint8_t cmd_s6(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List release-jitter and overruns of all tasks
+    return list_task_jitter(row) ? CMD_MORE : NO_ERR;
+} // cmd_s6()
+
+uint8_t cmd_s7(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List ISR timing statistics
+    return list_isr_timing(row) ? CMD_MORE : NO_ERR;
+} // cmd_s7()
+
+uint8_t cmd_s8(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Show number of rendered and skipped display rows
+    print_render_stats();
+    return NO_ERR;
+} // cmd_s8()
+
+uint8_t cmd_s9(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // Show dropped/lost bytes and wait time of UART
+    uart_print_stats();
+    return NO_ERR;
+} // cmd_s9()
+
+uint8_t cmd_h(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row);
+
+/*-----------------------------------------------------------------------------
+  All UART commands, in flash. A new command needs a handler, an entry here,
+  an index in cmd_index (same order) and a case in find_command(). A 1-letter
+  name has a number after it, e.g. 'p3'.
+  ---------------------------------------------------------------------------*/
+enum cmd_index {CMD_SP, CMD_PID, CMD_RB, CMD_RW, CMD_WB, CMD_WW, CMD_TE, CMD_TD,
+                CMD_S0, CMD_S1, CMD_S2, CMD_S3, CMD_S4, CMD_S5, CMD_S6, CMD_S7,
+                CMD_S8, CMD_S9, CMD_P, CMD_V, CMD_E, CMD_H};
+
+const cmd_struct cmd_list[] = 
+{
+    {"sp" , 1, cmd_sp, "sp[=x]: read/write setpoint in E-1 degrees"},
+    {"pid", 1, cmd_pid,"pid[=x]: read/fix pid-output in E-1 %, -1 = auto"},
+    {"rb" , 2, cmd_rb, "rb adr: read byte (hex)"},
+    {"rw" , 2, cmd_rw, "rw adr: read word (hex)"},
+    {"wb" , 3, cmd_wb, "wb adr x: write byte (hex)"},
+    {"ww" , 3, cmd_ww, "ww adr x: write word (hex)"},
+    {"te" , 2, cmd_te, "te x: enable task with handle x"},
+    {"td" , 2, cmd_td, "td x: disable task with handle x"},
+    {"s0" , 1, cmd_s0, "s0: version number"},
+    {"s1" , 1, cmd_s1, "s1: list all I2C devices"},
+    {"s2" , 1, cmd_s2, "s2: list all tasks"},
+    {"s3" , 1, cmd_s3, "s3: DS18B20 temperature"},
+    {"s4" , 1, cmd_s4, "s4: CPU load"},
+    {"s5" , 1, cmd_s5, "s5: drift and missed releases of tasks"},
+    {"s6" , 1, cmd_s6, "s6: release-jitter and overruns of tasks"},
+    {"s7" , 1, cmd_s7, "s7: ISR timing"},
+    {"s8" , 1, cmd_s8, "s8: rendered and skipped display rows"},
+    {"s9" , 1, cmd_s9, "s9: dropped/lost UART bytes"},
+    {"p"  , 1, cmd_p,  "px: send profile x or parameters (x=6)"},
+    {"v"  , 1, cmd_v,  "vx=y: write y into eeprom word x"},
+    {"e"  , 1, cmd_e,  "e0/e1: echo of command lines off/on"},
+    {"h"  , 1, cmd_h,  "h: this help"}
+}; // cmd_list[]
+
+#define CMD_LIST_SIZE (sizeof(cmd_list) / sizeof(cmd_list[0]))
+
+uint8_t cmd_h(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row)
+{   // List all commands, one per row
+    if (row >= CMD_LIST_SIZE) return NO_ERR;
+    xputs(cmd_list[row].help);
+    xputs("\n");
+    return (row < CMD_LIST_SIZE - 1) ? CMD_MORE : NO_ERR;
+} // cmd_h()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Find a command in cmd_list[]. A switch on the 16-bit key (the
+             first 2 characters) selects the only possible entry, the rest
+             of the name is compared after that (only 'pid' has a rest).
+             A name that is not in cmd_list[] uses the 1-letter command with
+             the same first character, e.g. 'p' for 'p3'.
+  Variables: name: the 1st item of the command, see process_string()
+  Returns  : pointer to the command or NULL if not found
+  ---------------------------------------------------------------------------*/
+const cmd_struct *find_command(const char *name)
+{
+    uint8_t i;
+    
+    switch (CMD_KEY(name[0], name[1]))
+    {
+        case CMD_KEY('s','p'): i = CMD_SP;  break;
+        case CMD_KEY('p','i'): i = CMD_PID; break;
+        case CMD_KEY('r','b'): i = CMD_RB;  break;
+        case CMD_KEY('r','w'): i = CMD_RW;  break;
+        case CMD_KEY('w','b'): i = CMD_WB;  break;
+        case CMD_KEY('w','w'): i = CMD_WW;  break;
+        case CMD_KEY('t','e'): i = CMD_TE;  break;
+        case CMD_KEY('t','d'): i = CMD_TD;  break;
+        case CMD_KEY('s','0'): case CMD_KEY('s','1'): case CMD_KEY('s','2'): 
+        case CMD_KEY('s','3'): case CMD_KEY('s','4'): case CMD_KEY('s','5'): 
+        case CMD_KEY('s','6'): case CMD_KEY('s','7'): case CMD_KEY('s','8'): 
+        case CMD_KEY('s','9'): i = CMD_S0 + (name[1] - '0'); break;
+        default: 
+            if (isalpha(name[1])) return NULL; // unknown name of 2 or more letters
+            switch (name[0])
+            {   // 1-letter command, with or without a number
+                case 'p': return &cmd_list[CMD_P];
+                case 'v': return &cmd_list[CMD_V];
+                case 'e': return &cmd_list[CMD_E];
+                case 'h': return &cmd_list[CMD_H];
+                default : return NULL;
+            } // switch
+    } // switch
+    return strcmp(cmd_list[i].name + 2, name + 2) ? NULL : &cmd_list[i];
+} // find_command()
+
+/*-----------------------------------------------------------------------------
+  Purpose: interpret commands which are received via the UART, see cmd_list[]
+           for all commands or type 'h'.
   Variables: 
-          s: the string that contains the command from UART
-  Returns  : [NO_ERR, ERR_CMD, ERR_NUM, ERR_I2C] or ack. value for command
+          s  : the string that contains the command from UART
+          row: the row of the reply to send, 0 for the first call
+  Returns  : [NO_ERR, ERR_CMD, ERR_NUM, CMD_MORE]
   ---------------------------------------------------------------------------*/
-uint8_t execute_single_command(char *s)
+uint8_t execute_single_command(char *s, uint8_t row)
 {
-   uint8_t  num    = atoi(&s[1]); // convert number in command (until space is found)
-   uint8_t  rval   = NO_ERR;
-   char     s2[30]; // Used for printing to uart
-   char     s3[10]; // contains 1st sub-string of s
+   uint8_t  num = atoi(&s[1]); // convert number in command (until space is found)
+   char     s3[UART_BUFLEN];   // contains 1st sub-string of s
    uint16_t d1,d2;
    uint8_t  count;
+   const cmd_struct *p;
    
-   if (isalpha(s[1]))
-   {   // 2-character command
-       count = process_string(s,s3,&d1,&d2);
-       if (!strcmp(s3,"sp"))
-       {    // setpoint read/write
-           if (count > 1)
-           {   // write setpoint
-               setpoint = d1;
-               eeprom_write_config(EEADR_MENU_ITEM(SP), setpoint);
-           } // if
-           xputs("SP=");
-           print_value10(setpoint);
-       } // if
-       else if (!strcmp(s3,"pid"))
-       {   // pid-output read/write
-           if (count > 1)
-           {    // write pid-output
-               if (d1 > 1000)
-               {   // reset switch, auto-run pid controller
-                   pid_fx = 0;
-                   pid_sw = false;
-               } // if
-               else
-               {   // fix pid-output to a fixed value
-                   pid_fx = d1;
-                   pid_sw = true;
-               } // else
-           } // if
-           xputs("pid_out=");
-           print_value10(pid_fx);
-       } // else if
-       else if (!strcmp(s3,"rb"))
-       {   // Read Byte
-           sprintf(s2,"0x%X (%d)\n",*(uint8_t *)d1,*(uint8_t *)d1);
-           xputs(s2);
-       } // else if
-       else if (!strcmp(s3,"rw"))
-       {   // Read Word
-           sprintf(s2,"%X (%d)\n",*(uint16_t *)d1,*(uint16_t *)d1);
-           xputs(s2);
-       } // else if
-       else if (!strcmp(s3,"wb"))
-       {   // Write Byte
-           *(uint8_t *)d1 = (uint8_t)d2;
-       } // else if
-       else if (!strcmp(s3,"ww"))
-       {   // Write Word
-           *(uint16_t *)d1 = d2;
-       } // else if
-   } // else
-   else 
-   {  // single letter command
-      switch (s[0])
-      {
-       case 'p': // Request to send parameters or one of the profiles
-               if (num <= NO_OF_PROFILES)
-               {  // send Profile or parameters to the ESP8266 web-server
-                      send_eep_block(num);  
-               } // if
-               break;
-       case 's': // System commands
-               switch (num)
-               {
-               case 0: // Revision number
-                   xputs(version);
-                   break;
-               case 1: // List all I2C devices
-                   i2c_scan();
-                   break;
-               case 2: // List all tasks
-                   list_all_tasks(); 
-                   break;	
-               case 3: sprintf(s2,"ds18b20_read():%d, T=",(uint16_t)temp1_ow_err);
-                   xputs(s2);
-                   print_value10(temp1_ow_10);
-                   break;
-               default: rval = ERR_NUM;
-                        break;
-               } // switch
-               break;
-      case 'v': // A parameter of profile data-item has changed in the ESP8266 web-server
-               count = process_string(s,s3,&d1,&d2);
-               if (count > 1) eeprom_write_config(num,d1);
-               break;
-      default: rval = ERR_CMD;
-	       break;
-      } // switch
-    } // else
-   return rval;	
+   count = process_string(s,s3,&d1,&d2);
+   p     = find_command(s3);
+   if ((p == NULL) && (s3[0] == 's') && !isalpha(s3[1]))
+   {   // 's' with a number that is not in cmd_list[], e.g. 's' (is 's0') or 's10'
+       if (num > 9) return ERR_NUM;
+       s3[1] = '0' + num;
+       s3[2] = '\0';
+       p     = find_command(s3);
+   } // if
+   if (p == NULL)        return ERR_CMD;
+   if (count < p->arity) return ERR_NUM; // not enough parameters
+   return p->handler(num, count, d1, d2, row);
 } // execute_single_command()
@@ -22,14 +22,29 @@
 #define _COMMS_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #define NO_ERR  (0x00)
 #define ERR_CMD	(0x01)
 #define ERR_NUM	(0x02)
+#define CMD_MORE (0x80) /* reply not complete: call again with the next row */
 
-void    i2c_scan(void);
-void    send_eep_block(uint8_t num);
-uint8_t rs232_command_handler(void);
-uint8_t execute_single_command(char *s);
+// Key of a UART command: its first 2 characters, see find_command() in comms.c
+#define CMD_KEY(c1,c2) ((uint16_t)(((uint16_t)(c1) << 8) | (uint8_t)(c2)))
+
+// One UART command
+typedef struct _cmd_struct
+{
+    const char *name;     // command name, e.g. "sp" or "p" for "p0".."p6"
+    uint8_t     arity;    // min. number of items, see process_string()
+    uint8_t  (* handler)(uint8_t num, uint8_t count, uint16_t d1, uint16_t d2, uint8_t row);
+    const char *help;     // help text, shown with command h
+} cmd_struct;
+
+bool    i2c_scan(uint8_t row);
+bool    send_eep_block(uint8_t num, uint8_t row);
+uint8_t rs232_command_handler(uint8_t row);
+const cmd_struct *find_command(const char *name);
+uint8_t execute_single_command(char *s, uint8_t row);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+/*==================================================================
+  File Name    : coroutine.h
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : This is the header-file with macros for stackless coroutines
+            (protothread-style). A long running task can be split into
+            slices with CR_YIELD(): the task returns to the scheduler and
+            continues after the CR_YIELD() at the next call of
+            dispatch_tasks(), without waiting for its next period.
+            Restrictions:
+            - local variables are NOT preserved across a CR_YIELD(),
+              use static variables instead.
+            - a switch statement may not contain a CR_YIELD().
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file.  If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#ifndef _COROUTINE_H
+#define _COROUTINE_H
+
+#include <stdint.h>
+#include "scheduler.h"
+
+typedef uint16_t cr_state; // resume point of a coroutine, 0 = start of coroutine
+
+// Start of the body of a coroutine, s is a static cr_state variable
+#define CR_BEGIN(s) switch (s) { case 0:
+
+// Return to the scheduler, continue here at the next dispatch_tasks()
+#define CR_YIELD(s) do { (s) = __LINE__; task_yield(); return; case __LINE__: ; } while (0)
+
+// End of the body of a coroutine, the next call starts at CR_BEGIN() again
+#define CR_END(s)   } (s) = 0
+
+#endif
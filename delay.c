@@ -21,67 +21,145 @@
 #include "delay.h"
 #include "w3230_main.h" 
 #include <stdint.h>
+#include <stdbool.h>
 #include <intrinsics.h> 
 
-uint32_t t2_millis = 0L; // Updated in TMR2 interrupt
+volatile uint32_t t2_millis = 0L; // Updated in TMR2 interrupt
+volatile uint16_t t2_epoch  = 0;  // Number of wraps of t2_millis
+volatile uint8_t  t2_seq    = 0;  // Incremented after every update of t2_millis
+uint16_t          dly_x16   = DLY_X16_DEFAULT; // delay_loops() per 16 usec., see delay_init()
+
+/*------------------------------------------------------------------
+  Purpose  : This function updates the monotonic time and should only
+	     be called from the TMR2 interrupt, every millisecond.
+	     t2_seq is incremented last: a reader that sees the same 
+	     t2_seq before and after reading has a consistent value.
+  Variables: -
+  Returns  : -
+  ------------------------------------------------------------------*/
+void time_tick(void)
+{
+	if (++t2_millis == 0) t2_epoch++;
+	t2_seq++;
+} // time_tick()
+
+/*------------------------------------------------------------------
+  Purpose  : This function returns the monotonic time since power-up.
+	     No interrupts are disabled: the values are read again
+	     when the TMR2 interrupt updated them while reading.
+  Variables: t: the time as epoch + msec.
+  Returns  : -
+  ------------------------------------------------------------------*/
+void time_now(mono_time *t)
+{
+	uint8_t s;
+
+	do
+	{
+		s        = t2_seq;
+		t->epoch = t2_epoch;
+		t->msec  = t2_millis;
+	} while (s != t2_seq);
+} // time_now()
+
+/*------------------------------------------------------------------
+  Purpose  : This function returns the number of seconds since power-up.
+	     It does not wrap for 136 years.
+  Variables: -
+  Returns  : The number of seconds since power-up
+  ------------------------------------------------------------------*/
+uint32_t uptime_sec(void)
+{
+	mono_time t;
+	uint32_t  r;
+
+	time_now(&t);
+	// 2^32 msec. = 4294967 sec. + 296 msec.
+	r = (uint32_t)t.epoch * 296;
+	return (uint32_t)t.epoch * 4294967L + r / 1000 + t.msec / 1000 +
+	       (r % 1000 + t.msec % 1000) / 1000;
+} // uptime_sec()
 
 /*------------------------------------------------------------------
   Purpose  : This function returns the number of milliseconds since
-	     power-up. It is defined in delay.h
+	     power-up. It is defined in delay.h. The value wraps every
+	     49.7 days, use unsigned differences (millis() - start) only.
   Variables: -
   Returns  : The number of milliseconds since power-up
   ------------------------------------------------------------------*/
 uint32_t millis(void)
 {
-	unsigned long m;
-	// disable interrupts while we read timer0_millis or we might get an
-	// inconsistent value (e.g. in the middle of a write to timer0_millis)
-	__disable_interrupt();
-	m = t2_millis;
-	__enable_interrupt();
+	uint8_t  s;
+	uint32_t m;
+
+	do
+	{   // read again if the TMR2 interrupt updated t2_millis meanwhile
+		s = t2_seq;
+		m = t2_millis;
+	} while (s != t2_seq);
 	return m;
 } // millis()
 
+/*------------------------------------------------------------------
+  Purpose  : This function returns the number of microseconds since
+	     power-up. It combines the millisecond counter with the
+	     value of TMR2, which runs at 1 MHz. It overflows after 71.6 
+	     minutes, so it should only be used for time differences.
+  Variables: -
+  Returns  : The number of microseconds since power-up
+  ------------------------------------------------------------------*/
+uint32_t micros(void)
+{
+	uint8_t  s;
+	uint32_t m;
+	uint16_t t;
+	bool     uif;
+	
+	do
+	{   // read again if the TMR2 interrupt updated t2_millis meanwhile
+		s   = t2_seq;
+		m   = t2_millis;
+		t   = tmr2_val();
+		uif = TIM2_SR1_UIF;
+	} while (s != t2_seq);
+	// TMR2 overflowed, but t2_millis is not updated yet by the interrupt
+	if (uif && (t < 500)) m++;
+	return m * 1000 + t;
+} // micros()
+
 /*------------------------------------------------------------------
   Purpose  : This function waits a number of milliseconds.  
              Do NOT use this in an interrupt.
-	     TODO: fails every 49.7 days
   Variables: 
          ms: The number of milliseconds to wait.
   Returns  : -
   ------------------------------------------------------------------*/
 void delay_msec(uint16_t ms)
 {
-    uint8_t  i;
-    uint32_t tmr;
     uint32_t start = millis();
     
-    do
-    {   
-        for (i = 0; i < 100; i++) ;
-        tmr = millis();
-	if (tmr < start)
-        {
-            start = 0xffffffff - start;
-            start++;
-        } // if
-    } while ((tmr - start) < ms);
+    while ((millis() - start) < ms) ; // unsigned difference, also ok when millis() wraps
 } // delay_msec()
 
 /*------------------------------------------------------------------
   Purpose  : This function reads the value of TMR2 which runs at 1 MHz.
+             Also used in interrupt routines (ISR_ENTER): the UART RX
+             interrupt can interrupt the TMR2 and UART TX interrupts.
+             The interrupt state is restored afterwards.
   Variables: -
   Returns  : the value from TMR2
   ------------------------------------------------------------------*/
 uint16_t tmr2_val(void)
 {
-    uint8_t  h,l;
-    uint16_t tmr;
+    uint8_t    h,l;
+    uint16_t   tmr;
+    __istate_t istate = __get_interrupt_state();
     
+    // an interrupt that also reads TMR2 (ISR_ENTER) would release the latched LSB
     __disable_interrupt();
-    h = TIM2_CNTRH;
+    h = TIM2_CNTRH; // reading MSB first latches LSB
     l = TIM2_CNTRL;
-    __enable_interrupt();
+    __set_interrupt_state(istate);
     tmr   = h;
     tmr <<= 8;
     tmr  |= l;	
@@ -89,19 +167,94 @@ uint16_t tmr2_val(void)
 } // tmr2_val()
 
 /*------------------------------------------------------------------
-  Purpose  : This function waits a number of microseconds.  
-             Do NOT use this in an interrupt.
+  Purpose  : This function is the delay-loop for all short delays. 
+             It does not use a timer and does not disable interrupts.
+             The time per loop is measured by delay_init().
   Variables: 
-         ms: The number of microseconds to wait.
+          n: The number of loops.
   Returns  : -
   ------------------------------------------------------------------*/
-void delay_usec(uint16_t us)
+void delay_loops(uint16_t n)
 {
-    uint16_t tmr;
-    uint16_t start = tmr2_val();
+    while (n--) __no_operation();
+} // delay_loops()
+
+/*------------------------------------------------------------------
+  Purpose  : This function measures the time of delay_loops() with TMR2
+             (1 MHz), so that the delays are correct for any clock and
+             compiler setting. Call once at power-up, after TMR2 is 
+             started and before the I2C bus is used.
+  Variables: -
+  Returns  : -
+  ------------------------------------------------------------------*/
+void delay_init(void)
+{
+    uint16_t   t0, t1;
+    __istate_t istate = __get_interrupt_state();
+    
+    __disable_interrupt(); // no interrupts during the measurement
     do 
-    {
-        tmr = tmr2_val();
-        if (tmr < start) start = 1001 - start;
-    } while ((tmr - start) < us);
+    {   // start early in the TMR2 period, so TMR2 does not wrap during the measurement
+        t0 = tmr2_val();
+    } while (t0 > 400);
+    delay_loops(DLY_CAL_LOOPS);
+    t1 = tmr2_val();
+    __set_interrupt_state(istate);
+    if (t1 > t0) dly_x16 = (uint16_t)(((uint32_t)DLY_CAL_LOOPS << 4) / (t1 - t0));
+} // delay_init()
+
+/*------------------------------------------------------------------
+  Purpose  : This function converts a number of microseconds into the
+             number of loops for delay_loops().
+  Variables: 
+         us: The number of microseconds, max. 16383.
+  Returns  : The number of loops
+  ------------------------------------------------------------------*/
+uint16_t usec_to_loops(uint16_t us)
+{
+    uint32_t n = ((uint32_t)us * dly_x16) >> 4;
+    return (n > 0xFFFF) ? 0xFFFF : (uint16_t)n;
+} // usec_to_loops()
+
+/*------------------------------------------------------------------
+  Purpose  : This function waits a number of microseconds. Interrupts 
+             are not disabled, so an interrupt may make it longer.
+  Variables: 
+         us: The number of microseconds to wait.
+  Returns  : -
+  ------------------------------------------------------------------*/
+void delay_usec(uint16_t us)
+{
+    while (us > 10000)
+    {   // max. number of loops is 65535
+        delay_loops(usec_to_loops(10000));
+        us -= 10000;
+    } // while
+    delay_loops(usec_to_loops(us));
 } // delay_usec()
+
+/*------------------------------------------------------------------
+  Purpose  : This function returns the end-time of a timeout, to be 
+             used with timeout_expired(). It uses millis() and not the
+             epoch of time_now(): a timeout is at most 65.5 seconds.
+  Variables: 
+         ms: The timeout in milliseconds.
+  Returns  : The end-time of the timeout
+  ------------------------------------------------------------------*/
+uint32_t timeout_set(uint16_t ms)
+{
+    return millis() + ms;
+} // timeout_set()
+
+/*------------------------------------------------------------------
+  Purpose  : This function checks if a timeout has expired. It is also
+             correct when millis() wraps: the signed difference is correct
+             for every timeout shorter than 24.8 days.
+  Variables: 
+        tmo: The end-time of the timeout, from timeout_set()
+  Returns  : true = timeout has expired
+  ------------------------------------------------------------------*/
+bool timeout_expired(uint32_t tmo)
+{
+    return (int32_t)(millis() - tmo) >= 0;
+} // timeout_expired()
@@ -22,9 +22,38 @@
 #define _DELAY_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
+// Mask only the TMR2 update interrupt instead of all interrupts, when data 
+// that is shared with the TMR2 interrupt (the scheduler) is accessed.
+// The UART interrupts can still be serviced. Needs <iostm8s105c6.h>.
+#define TMR2_LOCK()   (TIM2_IER_UIE = 0)
+#define TMR2_UNLOCK() (TIM2_IER_UIE = 1)
+
+// Monotonic time: milliseconds since power-up as epoch (number of wraps of
+// the 32-bit counter, every 49.7 days) + 32-bit msec. counter.
+typedef struct _mono_time
+{
+	uint16_t epoch; // number of times msec has wrapped
+	uint32_t msec;  // msec. within this epoch
+} mono_time;
+
+// Calibration of delay_loops(), see delay_init()
+#define DLY_CAL_LOOPS   (500) /* loops measured with TMR2, must take < 600 usec. */
+#define DLY_X16_DEFAULT  (64) /* loops in 16 usec. before calibration (4 per usec.) */
+
+void     time_tick(void);
+void     time_now(mono_time *t);
+uint32_t uptime_sec(void);
 uint32_t millis(void);
+uint32_t micros(void);
 void     delay_msec(uint16_t ms);
+uint16_t tmr2_val(void);
+void     delay_init(void);
+void     delay_loops(uint16_t n);
+uint16_t usec_to_loops(uint16_t us);
 void     delay_usec(uint16_t us);
+uint32_t timeout_set(uint16_t ms);
+bool     timeout_expired(uint32_t tmo);
 
 #endif
\ No newline at end of file
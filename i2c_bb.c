@@ -20,21 +20,17 @@
 */ 
 #include "i2c_bb.h"
 
+uint16_t i2c_loops_5us; // delay_loops() for 5 usec., set by i2c_init_bb()
+
 /*-----------------------------------------------------------------------------
-  Purpose  : This function creates a 5 usec delay (approximately) without
-             using a timer or an interrupt.
-  Variables: --
+  Purpose  : This function creates a 5 usec delay without using a timer or 
+             an interrupt. It uses the calibrated delay_loops().
+  Variables: x: number of 5 usec. delays
   Returns  : -
   ---------------------------------------------------------------------------*/
 void i2c_delay_5usec(uint16_t x)
 {
-    uint16_t j;
-    uint8_t  i;
-      
-    for (j = 0; j < x; j++)
-    {
-        for (i = 0; i < 80; i++) ; // 80 * 62.5 nsec (16 MHz) = 5 usec.
-    } // for j
+    while (x--) delay_loops(i2c_loops_5us);
 } // i2c_delay_5usec()
     
 /*-----------------------------------------------------------------------------
@@ -106,6 +102,7 @@ uint8_t i2c_reset_bus(void)
   ---------------------------------------------------------------------------*/
 void i2c_init_bb(void)
 {
+    i2c_loops_5us = usec_to_loops(5); // needs delay_init()
     SDA_1;   // Set SDA to 1
     SCL_1;   // Set SCL to 1
     SCL_out; // SCL is Push-Pull output
@@ -308,7 +305,7 @@ int8_t ds2482_detect(uint8_t addr)
 uint8_t ds2482_search_triplet(uint8_t search_direction, uint8_t addr)
 {
     uint8_t err, status;
-    int poll_count = 0;
+    uint32_t tmo = timeout_set(DS2482_OW_TIMEOUT);
     
     // 1-Wire Triplet (Case B)
     //   S AD,0 [A] 1WT [A] SS [A] Sr AD,1 [A] [Status] A [Status] A\ P
@@ -324,16 +321,16 @@ uint8_t ds2482_search_triplet(uint8_t search_direction, uint8_t addr)
         i2c_write_bb(search_direction ? 0x80 : 0x00);
         i2c_rep_start_bb(addr | I2C_READ);
         // loop checking 1WB bit for completion of 1-Wire operation 
-        // abort if poll limit reached
+        // abort if timeout expired
         status = i2c_read_bb(I2C_ACK); // Read byte
         do
         {
             if (status & STATUS_1WB) status = i2c_read_bb(I2C_ACK);
-        } while ((status & STATUS_1WB) && (poll_count++ < DS2482_OW_POLL_LIMIT));	
+        } while ((status & STATUS_1WB) && !timeout_expired(tmo));
         i2c_read_bb(I2C_NACK); // Read byte, generate I2C stop condition	   
         i2c_stop_bb();
-        // check for failure due to poll limit reached
-        if (poll_count >= DS2482_OW_POLL_LIMIT)
+        // check for failure due to timeout
+        if (status & STATUS_1WB)
         {
             ds2482_reset(addr); // handle error
             return false;
@@ -42,7 +42,7 @@
 // Standard speed (1WS==0), Strong Pullup disabled (SPU==0), Active Pullup enabled (APU==1)
 #define DS2482_ADDR          (0x30)
 #define DS2482_CONFIG        (0xE1)
-#define DS2482_OW_POLL_LIMIT  (200)
+#define DS2482_OW_TIMEOUT      (20) /* msec., max. time a 1-Wire command may take */
 
 // DS2482 commands
 #define CMD_DRST   (0xF0)
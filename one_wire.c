@@ -23,7 +23,7 @@
   along with this software.  If not, see <http://www.gnu.org/licenses/>.
   ================================================================== */ 
 #include "one_wire.h"
-#include "delay.h"         /* for delay_msec() */
+#include "delay.h"         /* for timeout_set() */
 
 // Search state
 uint8_t ROM_NO[8];
@@ -52,7 +52,7 @@ int8_t  short_detected;
 uint8_t OW_reset(uint8_t addr)
 {
     uint8_t err, status;
-    uint8_t poll_count = 0;
+    uint32_t tmo = timeout_set(DS2482_OW_TIMEOUT);
     
     // generate I2C start + output address to I2C bus
     err = (i2c_start_bb(addr | I2C_WRITE) == I2C_NACK);
@@ -61,17 +61,17 @@ uint8_t OW_reset(uint8_t addr)
         err  = (i2c_write_bb(CMD_1WRS) == I2C_NACK); // write register address
         i2c_rep_start_bb(addr | I2C_READ);
         // loop checking 1WB bit for completion of 1-Wire operation 
-        // abort if poll limit reached
+        // abort if timeout expired
         status = i2c_read_bb(I2C_ACK); // Read byte
         do
         {
             if (status & STATUS_1WB) status = i2c_read_bb(I2C_ACK);
         }
-        while ((status & STATUS_1WB) && (poll_count++ < DS2482_OW_POLL_LIMIT));
+        while ((status & STATUS_1WB) && !timeout_expired(tmo));
         status = i2c_read_bb(I2C_NACK);
         i2c_stop_bb();
-        // check for failure due to poll limit reached
-        if (poll_count >= DS2482_OW_POLL_LIMIT)
+        // check for failure due to timeout
+        if (status & STATUS_1WB)
         {
             ds2482_reset(addr); // handle error
             return false;
@@ -101,7 +101,7 @@ uint8_t OW_reset(uint8_t addr)
 uint8_t OW_touch_bit(uint8_t sendbit, uint8_t addr)
 {
     uint8_t err, status;
-    uint8_t poll_count = 0;
+    uint32_t tmo = timeout_set(DS2482_OW_TIMEOUT);
     
     // 1-Wire bit (Case B)
     //   S AD,0 [A] 1WSB [A] BB [A] Sr AD,1 [A] [Status] A [Status] A\ P
@@ -117,17 +117,17 @@ uint8_t OW_touch_bit(uint8_t sendbit, uint8_t addr)
         err  = (i2c_write_bb(sendbit ? 0x80 : 0x00) == I2C_NACK); // write register address
         i2c_rep_start_bb(addr | I2C_READ);
         // loop checking 1WB bit for completion of 1-Wire operation 
-        // abort if poll limit reached
+        // abort if timeout expired
         status = i2c_read_bb(I2C_ACK); // Read byte
         do
         {
             if (status & STATUS_1WB) status = i2c_read_bb(I2C_ACK);
         }
-        while ((status & STATUS_1WB) && (poll_count++ < DS2482_OW_POLL_LIMIT));
+        while ((status & STATUS_1WB) && !timeout_expired(tmo));
         status = i2c_read_bb(I2C_NACK);
         i2c_stop_bb();
-        // check for failure due to poll limit reached
-        if (poll_count >= DS2482_OW_POLL_LIMIT)
+        // check for failure due to timeout
+        if (status & STATUS_1WB)
         {
             ds2482_reset(addr); // handle error
             return false;
@@ -174,7 +174,7 @@ uint8_t OW_read_bit(uint8_t addr)
 uint8_t OW_write_byte(uint8_t sendbyte, uint8_t addr)
 {
     uint8_t err, status;
-    uint8_t poll_count = 0;
+    uint32_t tmo = timeout_set(DS2482_OW_TIMEOUT);
     
     // 1-Wire Write Byte (Case B)
     //   S AD,0 [A] 1WWB [A] DD [A] Sr AD,1 [A] [Status] A [Status] A\ P
@@ -190,17 +190,17 @@ uint8_t OW_write_byte(uint8_t sendbyte, uint8_t addr)
         err  = (i2c_write_bb(sendbyte) == I2C_NACK); // write register address
         i2c_rep_start_bb(addr | I2C_READ);
         // loop checking 1WB bit for completion of 1-Wire operation 
-        // abort if poll limit reached
+        // abort if timeout expired
         status = i2c_read_bb(I2C_ACK); // Read byte
         do
         {
             if (status & STATUS_1WB) status = i2c_read_bb(I2C_ACK);
         }
-        while ((status & STATUS_1WB) && (poll_count++ < DS2482_OW_POLL_LIMIT));
+        while ((status & STATUS_1WB) && !timeout_expired(tmo));
         status = i2c_read_bb(I2C_NACK);
         i2c_stop_bb();
-        // check for failure due to poll limit reached
-        if (poll_count >= DS2482_OW_POLL_LIMIT)
+        // check for failure due to timeout
+        if (status & STATUS_1WB)
         {
             ds2482_reset(addr); // handle error
             return false;
@@ -219,7 +219,7 @@ uint8_t OW_write_byte(uint8_t sendbyte, uint8_t addr)
 uint8_t OW_read_byte(uint8_t addr)
 {
     uint8_t err, data, status;
-    int poll_count = 0;
+    uint32_t tmo = timeout_set(DS2482_OW_TIMEOUT);
     
     // 1-Wire Read Bytes (Case C)
     //   S AD,0 [A] 1WRB [A] Sr AD,1 [A] [Status] A [Status] !A 
@@ -236,16 +236,16 @@ uint8_t OW_read_byte(uint8_t addr)
         err  = (i2c_write_bb(CMD_1WRB) == I2C_NACK); // write register address
         i2c_rep_start_bb(addr | I2C_READ);
         // loop checking 1WB bit for completion of 1-Wire operation 
-        // abort if poll limit reached
+        // abort if timeout expired
         status = i2c_read_bb(I2C_ACK); // Read byte
         do
         {
             if (status & STATUS_1WB) status = i2c_read_bb(I2C_ACK);
         }
-        while ((status & STATUS_1WB) && (poll_count++ < DS2482_OW_POLL_LIMIT));
+        while ((status & STATUS_1WB) && !timeout_expired(tmo));
         status = i2c_read_bb(I2C_NACK);
-        // check for failure due to poll limit reached
-        if (poll_count >= DS2482_OW_POLL_LIMIT)
+        // check for failure due to timeout
+        if (status & STATUS_1WB)
         {
             ds2482_reset(addr); // handle error
             return false;
@@ -581,48 +581,76 @@ uint8_t ds18b20_start_conversion(uint8_t i2c_addr)
 } // ds18b20_start_conversion()
 
 //--------------------------------------------------------------------------
-// Read a temperature from the DS18B20. At the highest resolution
-// (12-bit, default at power-up), it takes approx. 750 msec.
+// Send the Read Scratchpad command to the DS18B20, the 1st step of
+// ds18b20_read(). Read the result with ds18b20_read_result(), this can be
+// done later (e.g. in the next slice of a coroutine).
 //
 //     i2c_addr : DS2482 base address where DS18B20 is connection to
-// Return true  : device found, conversion started
+// Return true  : device found, command sent
 //        false : device not found
-// Variables:
-//      dvc : THLT = Read from the HLT DS18B20 sensor
-//            TMLT = Read from the MLT DS18B20 sensor
+//--------------------------------------------------------------------------
+uint8_t ds18b20_read_start(uint8_t i2c_addr)
+{
+    uint8_t rval;
+    
+    rval = OW_reset(i2c_addr);
+    if (rval == true)
+    {	// DS18B20 is present
+        OW_write_byte(OW_SKIP_ROM_CMD        , i2c_addr); // only 1 sensor, use SKIP ROM command
+        OW_write_byte(OW_READ_SCRATCHPAD_FCMD, i2c_addr); // Read scratchpad
+    } // if
+    return rval;
+} // ds18b20_read_start()
+
+//--------------------------------------------------------------------------
+// Read the temperature from the scratchpad of the DS18B20, the 2nd step of
+// ds18b20_read(). Call ds18b20_read_start() first.
+//
+//     i2c_addr : DS2482 base address where DS18B20 is connection to
+//     err      : 1 = error (no device or CRC error)
+//     s2       : 1 = only read the 2 temperature bytes
+//                0 = read the entire scratchpad and check the CRC
 // Returns  : The temperature from the DS18B20 in a signed Q8.4 format.
 //--------------------------------------------------------------------------
-int16_t ds18b20_read(uint8_t i2c_addr, uint8_t *err, uint8_t s2)
+int16_t ds18b20_read_result(uint8_t i2c_addr, uint8_t *err, uint8_t s2)
 {
-    int16_t  temp = 0;   // the Temp. from the DS18B20 as an int
     uint8_t  scratch[9]; // Scratchpad of DS18B20
     uint8_t  i;
     
-    *err = !OW_reset(i2c_addr); // false: error
-    if (!*err)
+    if (s2)
+    {	// only read 2 temperature bytes
+        scratch[0] = OW_read_byte(i2c_addr);
+        scratch[1] = OW_read_byte(i2c_addr);
+        *err = !OW_reset(i2c_addr); // false: error
+    }
+    else
     {
-        OW_write_byte(OW_SKIP_ROM_CMD        , i2c_addr); // only 1 sensor, use SKIP ROM command
-        OW_write_byte(OW_READ_SCRATCHPAD_FCMD, i2c_addr); // Read scratchpad
-        if (s2)
-        {	// only read 2 temperature bytes
-            scratch[0] = OW_read_byte(i2c_addr);
-            scratch[1] = OW_read_byte(i2c_addr);
-            *err = !OW_reset(i2c_addr); // false: error
-        }
-        else
+        crc8 = 0x00;
+        for (i = 0; i < 9; i++)
         {
-            crc8 = 0x00;
-            for (i = 0; i < 9; i++)
-            {
-                scratch[i] = OW_read_byte(i2c_addr);
-                if (i < 8) calc_crc8(scratch[i]);
-                //sprintf(s2,"%02X ",scratch[i]); uart_printf(s2);
-            } // for
-            *err = (crc8 != scratch[8]);
-            //if (*err) uart_printf("crc error\n");
-        } // else
-        temp   = ((int16_t)scratch[1] << 8) | scratch[0];
-        //temp <<= 3; // From Q8.4 to Q8.7
-    } // if	
-    return temp;    // Return value now in C << 7
+            scratch[i] = OW_read_byte(i2c_addr);
+            if (i < 8) calc_crc8(scratch[i]);
+            //sprintf(s2,"%02X ",scratch[i]); uart_printf(s2);
+        } // for
+        *err = (crc8 != scratch[8]);
+        //if (*err) uart_printf("crc error\n");
+    } // else
+    return ((int16_t)scratch[1] << 8) | scratch[0];
+} // ds18b20_read_result()
+
+//--------------------------------------------------------------------------
+// Read a temperature from the DS18B20: ds18b20_read_start() and 
+// ds18b20_read_result() at once. Start a conversion with 
+// ds18b20_start_conversion() approx. 750 msec. before (12-bit resolution).
+//
+//     i2c_addr : DS2482 base address where DS18B20 is connection to
+//     err      : 1 = error (no device or CRC error)
+//     s2       : 1 = only read the 2 temperature bytes
+// Returns  : The temperature from the DS18B20 in a signed Q8.4 format.
+//--------------------------------------------------------------------------
+int16_t ds18b20_read(uint8_t i2c_addr, uint8_t *err, uint8_t s2)
+{
+    *err = !ds18b20_read_start(i2c_addr); // false: error
+    if (*err) return 0;
+    return ds18b20_read_result(i2c_addr, err, s2);
 } // ds18b20_read()
@@ -50,6 +50,8 @@ void    OW_target_setup(uint8_t family_code);
 void    OW_family_skip_setup(void);
 uint8_t OW_search(uint8_t addr);
 uint8_t ds18b20_start_conversion(uint8_t i2c_addr);
+uint8_t ds18b20_read_start(uint8_t i2c_addr);
+int16_t ds18b20_read_result(uint8_t i2c_addr, uint8_t *err, uint8_t s2);
 int16_t ds18b20_read(uint8_t i2c_addr, uint8_t *err, uint8_t s2);
 
 // Helper functions
@@ -5,117 +5,113 @@
   Purpose : This is the header-file that defines all functions and
             structures for working with ring-buffers. These ring-buffers
 	    are primarily used for usart ISR driven communication.
+	    RING_BUFFER_DEF() generates a ring-buffer type with its own
+	    functions for an element type and a size.
+	    Every ring-buffer is single-producer/single-consumer: one side
+	    (e.g. an interrupt) only puts and the other side only gets.
+	    Then no interrupts need to be disabled:
+	    - the size is a power of 2, head and tail are free-running
+	      16-bit indices that are masked with (size-1). head - tail
+	      is the number of elements, so no slot is wasted.
+	    - the producer only writes head, the consumer only writes
+	      tail, both after the elements are written or read. A 16-bit
+	      index is read and written with a single (LDW) instruction.
   ==================================================================
-*/ 
+*/
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
-struct ring_buffer 
-{
-    volatile uint8_t write_offset;
-    volatile uint8_t read_offset;
-    uint8_t          size;
-    uint8_t          *buffer;
-}; /* ring_buffer */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Get the next offset in a ring buffer.
-  Variables: cur_offset: the current offset in the ring buffer
-             max_offset: the highest allowed offset in the ring buffer
-  Returns  : next offset or 0 if we are wrapping
-  ---------------------------------------------------------------------------*/
-static inline uint8_t get_next(uint8_t cur_offset, uint8_t max_offset)
-{
-   return ((cur_offset == max_offset-1) ? 0 : cur_offset + 1);
-} /* get_next() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Get the next write offset in a ring buffer
-  Variables: ring: pointer to a struct of type ring_buffer
-  Returns  : the next write offset in the ring buffer
-  ---------------------------------------------------------------------------*/
-static inline uint8_t ring_buffer_get_next_write(const struct ring_buffer *ring)
-{
-    return get_next(ring->write_offset, ring->size);
-} /* ring_buffer_get_next_write() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Get the next read offset in a ring buffer
-  Variables: ring: pointer to a struct of type ring_buffer
-  Returns  : the next read offset in the ring buffer
-  ---------------------------------------------------------------------------*/
-static inline uint8_t ring_buffer_get_next_read(const struct ring_buffer *ring)
-{
-    return get_next(ring->read_offset, ring->size);
-} /* ring_buffer_get_next_read() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Function for checking if the ring buffer is full.
-  Variables: ring: pointer to a struct of type ring_buffer
-  Returns  : true: buffer is full ; false: space is available in the ring buffer
-  ---------------------------------------------------------------------------*/
-static inline bool ring_buffer_is_full(const struct ring_buffer *ring)
-{
-    return (ring->read_offset == ring_buffer_get_next_write(ring));
-} /* ring_buffer_is_full() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Function for checking if the ring buffer is empty
-  Variables: ring: pointer to a struct of type ring_buffer
-  Returns  : true: buffer is empty ; false: there is still data in the ring buffer
-  ---------------------------------------------------------------------------*/
-static inline bool ring_buffer_is_empty(const struct ring_buffer *ring)
-{
-    uint8_t r = ring->read_offset;
-    return (r == ring->write_offset);
-} /* ring_buffer_is_empty() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Function for initializing a ring buffer
-  Variables: buffer: pointer to the buffer to use as a ring buffer
-             size  : the size of the ring buffer
-  Returns  : struct containing the ring buffer
-  ---------------------------------------------------------------------------*/
-static inline struct ring_buffer ring_buffer_init(uint8_t *buffer, uint8_t size)
-{
-    struct ring_buffer ring;
-    ring.write_offset = 0;
-    ring.read_offset  = 0;
-    ring.size         = size;
-    ring.buffer       = buffer;
-    return ring;
-} /* ring_buffer_init() */
-
-/*-----------------------------------------------------------------------------
-  Purpose  : Function for getting one byte from the ring buffer
-             Make sure buffer is not empty (using ring_buffer_is_empty) 
-             before calling this function.
-  Variables: ring: pointer to a struct of type ring_buffer
-  Returns  : next byte in buffer
-  ---------------------------------------------------------------------------*/
-static inline uint8_t ring_buffer_get(struct ring_buffer *ring)
-{
-    //Assert(!ring_buffer_is_empty(ring));
-    uint8_t data = ring->buffer[ring->read_offset];
-    ring->read_offset = ring_buffer_get_next_read(ring);
-    return data;
-} /* ring_buffer_get() */
-
 /*-----------------------------------------------------------------------------
-  Purpose  : Function for putting a data byte in the ring buffer. 
-             Make sure buffer is not full (using ring_buffer_is_full) 
-             before calling this function.
-  Variables: ring: pointer to a struct of type ring_buffer
-             data: the byte to put into the buffer
+  Purpose  : Generates struct name and the following functions for it.
+             Producer only: name_put(), name_write(), name_free(), name_is_full()
+             Consumer only: name_get(), name_read(), name_peek(), name_commit(),
+                            name_count(), name_is_empty()
+             name_init() is called before the ring buffer is used.
+             - name_put()/name_get(): put/get one element. Check first with
+               name_is_full()/name_is_empty().
+             - name_write()/name_read(): put/get max. n elements, returns
+               the number of elements put/got, the index is updated once.
+             - name_peek(): returns a pointer to the oldest element and the
+               number of elements that can be read from there without
+               wrapping. name_commit() removes them after use (zero-copy).
+  Variables: name: name of the struct and prefix of the functions
+             type: type of one element, e.g. uint8_t
+             size: number of elements, a power of 2 [2..32768]
   Returns  : -
   ---------------------------------------------------------------------------*/
-static inline void ring_buffer_put(struct ring_buffer *ring, uint8_t data)
-{
-    //Assert(!ring_buffer_is_full(ring));   
-    ring->buffer[ring->write_offset] = data;
-    ring->write_offset = ring_buffer_get_next_write(ring);
-} /* ring_buffer_put() */
+#define RING_BUFFER_DEF(name, type, size)                                    \
+typedef char name##_size_check[(((size) & ((size) - 1)) == 0) ? 1 : -1];    \
+struct name                                                                  \
+{                                                                            \
+    volatile uint16_t head;      /* write index, only changed by producer */ \
+    volatile uint16_t tail;      /* read index, only changed by consumer */  \
+    volatile type     buf[size];                                             \
+}; /* name */                                                                \
+static inline void name##_init(struct name *r)                               \
+{                                                                            \
+    r->head = r->tail = 0;                                                   \
+}                                                                            \
+static inline uint16_t name##_count(const struct name *r)                    \
+{                                                                            \
+    return (uint16_t)(r->head - r->tail);                                    \
+}                                                                            \
+static inline uint16_t name##_free(const struct name *r)                     \
+{                                                                            \
+    return (size) - name##_count(r);                                         \
+}                                                                            \
+static inline bool name##_is_empty(const struct name *r)                     \
+{                                                                            \
+    return r->head == r->tail;                                               \
+}                                                                            \
+static inline bool name##_is_full(const struct name *r)                      \
+{                                                                            \
+    return name##_count(r) == (size);                                        \
+}                                                                            \
+static inline void name##_put(struct name *r, type x)                        \
+{                                                                            \
+    uint16_t h = r->head;                                                    \
+    r->buf[h & ((size) - 1)] = x;                                            \
+    r->head = h + 1;             /* element is written before head */        \
+}                                                                            \
+static inline type name##_get(struct name *r)                                \
+{                                                                            \
+    uint16_t t = r->tail;                                                    \
+    type     x = r->buf[t & ((size) - 1)];                                   \
+    r->tail = t + 1;             /* element is read before tail */           \
+    return x;                                                                \
+}                                                                            \
+static inline uint16_t name##_write(struct name *r, const type *src, uint16_t n) \
+{                                                                            \
+    uint16_t i, h = r->head;                                                 \
+    uint16_t f = (size) - (uint16_t)(h - r->tail);                           \
+    if (n > f) n = f;                                                        \
+    for (i = 0; i < n; i++) r->buf[(h + i) & ((size) - 1)] = src[i];         \
+    r->head = h + n;                                                         \
+    return n;                                                                \
+}                                                                            \
+static inline uint16_t name##_read(struct name *r, type *dst, uint16_t n)    \
+{                                                                            \
+    uint16_t i, t = r->tail;                                                 \
+    uint16_t c = (uint16_t)(r->head - t);                                    \
+    if (n > c) n = c;                                                        \
+    for (i = 0; i < n; i++) dst[i] = r->buf[(t + i) & ((size) - 1)];         \
+    r->tail = t + n;                                                         \
+    return n;                                                                \
+}                                                                            \
+static inline volatile type *name##_peek(struct name *r, uint16_t *n)        \
+{                                                                            \
+    uint16_t t = r->tail & ((size) - 1);                                     \
+    uint16_t c = name##_count(r);                                            \
+    if (c > (size) - t) c = (size) - t; /* up to the end of buf */           \
+    *n = c;                                                                  \
+    return &r->buf[t];                                                       \
+}                                                                            \
+static inline void name##_commit(struct name *r, uint16_t n)                 \
+{                                                                            \
+    r->tail += n;                                                            \
+}
 
 #endif /* RING_BUFFER_H */
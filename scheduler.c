@@ -19,15 +19,54 @@
   along with this file.  If not, see <http://www.gnu.org/licenses/>.
   ==================================================================
 */ 
+#include <iostm8s105c6.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "scheduler.h"
 #include "delay.h"
 #include "uart.h"
+#include <intrinsics.h>
+
+extern volatile uint32_t t2_millis; // Millisecond counter, updated in TMR2 interrupt
 
 task_struct task_list[MAX_TASKS]; // struct with all tasks
 uint8_t max_tasks = 0;
+#if SCHED_DELTA_QUEUE
+uint8_t dq_head = NO_TASK;        // index of 1st task in delta-queue
+#endif
+// The scheduler, the software timers and the profiling use millis() and
+// micros(), they only use differences that are correct when these wrap:
+// catch-up and timers are clipped to 65.5 sec., Drift is a signed difference
+// (< 24.8 days), durations and jitter are usec_diff() of a single run.
+// Only the ISR statistics (s7) can cover more than 49.7 days: time_now().
+#if SCHED_FOREGROUND
+uint32_t sched_tick = 0;          // time of last tick handled by scheduler_catchup()
+#endif
+uint8_t  cur_task   = NO_TASK;    // index of task that is running
+uint32_t idle_usec  = 0;          // time spent in WFI in current load window
+uint32_t idle_cnt   = 0;          // number of times WFI was executed
+uint32_t load_start = 0;          // start of current load window in usec.
+uint16_t cpu_load   = 0;          // CPU load in E-1 % of the previous load window
+
+volatile uint8_t ev_pending = 0;  // events posted with event_post()
+#if ISR_TIMING
+isr_struct isr_list[NR_ISRS];     // timing statistics of interrupt routines
+mono_time isr_start[NR_ISRS];     // time at start of ISR statistics, per ISR
+const char * const isr_name[NR_ISRS] = {"TMR2","UART-TX","UART-RX"};
+#endif
+timer_struct timer_list[MAX_TIMERS]; // pool with all software timers
+#if SCHED_AUTO_PHASE
+uint32_t stagger_loops = 0;       // number of loops of the last phase search, see scheduler_stagger()
+uint32_t stagger_usec  = 0;       // duration of the last phase search in usec. (all chunks)
+uint8_t  stg_i  = NO_TASK;        // task being placed (index in the order), NO_TASK = no search
+uint16_t stg_o;                   // next phase to try for this task
+uint16_t stg_best_o;              // best phase found so far for this task
+uint16_t stg_best_coll;           // its number of collisions
+int32_t  stg_best_slack;          // and its free time
+#endif
+uint32_t tmr_last   = 0;          // millis() at previous call of timers_update()
 
 /*-----------------------------------------------------------------------------
   Purpose  : Initialization function for scheduler. Should be called before 
@@ -38,92 +77,678 @@ uint8_t max_tasks = 0;
 void scheduler_init(void)
 {
 	  memset(task_list,0x00,sizeof(task_list)); // clear task_list array
+	  memset(timer_list,0x00,sizeof(timer_list)); // clear timer pool
+#if ISR_TIMING
+	  memset(isr_list,0x00,sizeof(isr_list));     // clear ISR statistics
+#endif
+	  ev_pending = 0;
+#if SCHED_FOREGROUND
+	  sched_tick = millis(); // no ticks to catch up yet
+#endif
+#if SCHED_DELTA_QUEUE
+	  dq_head = NO_TASK; // delta-queue is empty
+#endif
 } // scheduler_init()
 
+#if SCHED_DELTA_QUEUE
+/*-----------------------------------------------------------------------------
+  Purpose  : Insert a task into the delta-queue. The queue is sorted by the
+             time-to-next-run and every Counter holds the number of ticks 
+             after its predecessor in the queue. Tasks with the same time are
+             inserted after the tasks already present (FIFO).
+             The TMR2 interrupt must be masked (TMR2_LOCK) when called outside of an ISR.
+  Variables: index: index of task in task_list[]
+             ticks: number of ticks until the task becomes ready
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void dq_insert(uint8_t index, uint16_t ticks)
+{
+	uint8_t *p = &dq_head; // the link that will point to the new task
+
+	while ((*p != NO_TASK) && (task_list[*p].Counter <= ticks))
+	{
+		ticks -= task_list[*p].Counter; // make relative to this task
+		p      = &task_list[*p].Next;
+	} // while
+	task_list[index].Counter = ticks;
+	task_list[index].Next    = *p;
+	if (*p != NO_TASK) task_list[*p].Counter -= ticks; // successor is now relative to new task
+	*p = index;
+} // dq_insert()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Remove a task from the delta-queue, if it is in the queue. The 
+             ticks of the task are added to its successor, so the release-times
+             of the other tasks do not change.
+             The TMR2 interrupt must be masked (TMR2_LOCK) when called outside of an ISR.
+  Variables: index: index of task in task_list[]
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void dq_remove(uint8_t index)
+{
+	uint8_t *p = &dq_head; // the link that points to the task
+
+	while ((*p != NO_TASK) && (*p != index)) p = &task_list[*p].Next;
+	if (*p == NO_TASK) return; // not in the delta-queue
+	*p = task_list[index].Next;
+	if (*p != NO_TASK) task_list[*p].Counter += task_list[index].Counter;
+	task_list[index].Next = NO_TASK;
+} // dq_remove()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Release a task: set the ready flag, store the release-time 
+             (SCHED_JITTER) and update the drift of the release-time 
+             (SCHED_DRIFT). A task that is still ready from its previous 
+             periodic release has missed this release. A task that is ready
+             because of an event has not missed anything.
+             Should be called from within scheduler_ticks() only.
+  Variables: index: index of task in task_list[]
+             tick : time in msec. of the tick that releases the task
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void release_task(uint8_t index, uint32_t tick)
+{
+	task_struct *p = &task_list[index];
+
+#if SCHED_DRIFT
+	p->Drift  = (int32_t)(tick - p->Ideal); // Drift since add_task()
+	p->Ideal += p->Period;                   // Next ideal release-time
+	if ((p->Status & (TASK_READY | TASK_ENABLED | TASK_EVENT)) == (TASK_READY | TASK_ENABLED))
+		p->Missed++; // previous periodic release not yet dispatched
+#endif
+#if SCHED_JITTER
+	if (!(p->Status & TASK_READY)) p->Release = tick; // else keep the release-time of the previous one
+#endif
+	p->Status |= TASK_READY;
+} // release_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Advance the scheduler a number of ticks and set the ready flag
+             of all tasks that time-out within these ticks.
+             With SCHED_DELTA_QUEUE the ticks are subtracted from the head of
+             the delta-queue at once, so the time spent here does not depend
+             on the number of tasks or the number of ticks.
+  Variables: n  : number of ticks, normally 1
+             now: time in msec. of the last tick
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void scheduler_ticks(uint16_t n, uint32_t now)
+{
+	uint8_t  index = 0;      // index in task_list struct
+	uint32_t tick  = now - n; // time of the previous tick
+#if SCHED_DELTA_QUEUE
+	uint16_t d;
+
+	while (n && (dq_head != NO_TASK))
+	{
+		d = task_list[dq_head].Counter;
+		if (d == 0) d = 1; // 0 ticks left: released at the next tick
+		if (d > n)
+		{   // head of queue does not time-out within these ticks
+			task_list[dq_head].Counter -= n;
+			break;
+		} // if
+		n    -= d;
+		tick += d;
+		task_list[dq_head].Counter = 0;
+		while ((dq_head != NO_TASK) && (task_list[dq_head].Counter == 0))
+		{	// time-out for head of queue (and all tasks that follow with 0 ticks)
+			index = dq_head;
+			release_task(index, tick);
+			dq_head = task_list[index].Next; // remove from delta-queue
+#if SCHED_ABSOLUTE
+			dq_insert(index, task_list[index].Period); // next release from this release
+#endif
+		} // while
+	} // while
+#else
+	while (n--)
+	{
+		tick++;
+		index = 0;
+		while ((index < MAX_TASKS) && task_list[index].pFunction)
+		{
+			//First go through the initial delay
+			if(task_list[index].Delay > 0)
+			{
+				task_list[index].Delay--;
+			} // if
+			else
+			{	//now we decrement the actual period counter 
+				task_list[index].Counter--;
+				if(task_list[index].Counter == 0)
+				{
+					//Set the flag and reset the counter;
+					release_task(index, tick);
+#if SCHED_ABSOLUTE
+					task_list[index].Counter = task_list[index].Period; // next release from this release
+#endif
+				} // if
+			} // else
+			index++;
+		} // while
+	} // while
+#endif
+} // scheduler_ticks()
+
 /*-----------------------------------------------------------------------------
   Purpose  : Run-time function for scheduler. Should be called from within
-             an ISR. This function goes through the task-list and decrements
-             eacht task counter. On time-out, the ready flag is set.
+             an ISR, every tick. Not used with SCHED_FOREGROUND, then 
+             dispatch_tasks() calls scheduler_catchup().
   Variables: task_list[] structure
   Returns  : -
   ---------------------------------------------------------------------------*/
 void scheduler_isr(void)
 {
-	uint8_t index = 0; // index in task_list struct
+	scheduler_ticks(1, t2_millis);
+} // scheduler_isr()
+
+#if SCHED_FOREGROUND
+/*-----------------------------------------------------------------------------
+  Purpose  : Advance the scheduler with all ticks since the previous call.
+             Called from dispatch_tasks(), so the TMR2 interrupt only has 
+             to update t2_millis.
+  Variables: sched_tick
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void scheduler_catchup(void)
+{
+	uint32_t now = millis();
+	uint32_t n   = now - sched_tick; // number of ticks not handled yet
+
+	if (n == 0) return;
+	if (n > 0xFFFF) n = 0xFFFF; // more than a minute behind: skip the rest
+	scheduler_ticks((uint16_t)n, now);
+	sched_tick = now;
+} // scheduler_catchup()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Time between two readings of micros(). The unsigned difference
+             is also correct when micros() has wrapped (every 71.6 minutes)
+             between the two readings.
+  Variables: t1: the later time in usec.
+             t0: the earlier time in usec.
+  Returns  : t1 - t0 in usec.
+  ---------------------------------------------------------------------------*/
+uint32_t usec_diff(uint32_t t1, uint32_t t0)
+{
+	return t1 - t0;
+} // usec_diff()
+
+#if SCHED_PROFILING || SCHED_JITTER
+/*-----------------------------------------------------------------------------
+  Purpose  : Add a value to an average that is kept as a sum and a count.
+             Before the sum or the count can overflow, both are halved: the
+             average is then over the more recent values.
+  Variables: sum: sum of the values
+             cnt: number of values in sum
+             v  : the value to add
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void avg_add(uint32_t *sum, uint16_t *cnt, uint16_t v)
+{
+	if ((*cnt == UINT16_MAX) || (*sum & 0x80000000))
+	{
+		*sum >>= 1;
+		*cnt >>= 1;
+	} // if
+	*sum += v;
+	(*cnt)++;
+} // avg_add()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Update the profiling data of a task after it has run: last
+             and max. duration and with SCHED_PROFILING the min. and average
+             duration, number of runs and the histogram of task-durations.
+             The slices of a coroutine are added up in Duration, a run is 
+             only counted at CR_END().
+  Variables: index: index of task in task_list[]
+             usec : measured duration of this slice in usec.
+             done : true = task has finished, false = task yielded
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void profile_task(uint8_t index, uint32_t usec, bool done)
+{
+	task_struct *p = &task_list[index];
+	uint16_t     d;
+
+	usec += p->Duration; // Duration is set to 0 at the 1st slice of a run
+	d     = (usec > UINT16_MAX) ? UINT16_MAX : (uint16_t)usec;
+	p->Duration = d;
+	if (!done) return; // more slices follow
+	if (d > p->Duration_Max)                     p->Duration_Max = d;
+#if SCHED_PROFILING
+	if ((p->Runs == 0) || (d < p->Duration_Min)) p->Duration_Min = d;
+	avg_add(&p->Duration_Sum, &p->Sum_Cnt, d);
+	p->Runs++;
+	if      (d <   100) index = 0;
+	else if (d <  1000) index = 1;
+	else if (d < 10000) index = 2;
+	else                index = 3;
+	if (p->Hist[index] < UINT16_MAX) p->Hist[index]++;
+#endif
+} // profile_task()
 
+#if SCHED_JITTER
+/*-----------------------------------------------------------------------------
+  Purpose  : Update the release-jitter of a task: the time between the release
+             of a task by scheduler_isr() and the actual start of the task by
+             dispatch_tasks(). Without SCHED_ABSOLUTE, a task that starts a 
+             full period (or more) after its periodic release is counted as an
+             overrun. A release by an event is not periodic and is not counted.
+  Variables: index: index of task in task_list[]
+             start: start-time of the task in usec.
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void jitter_task(uint8_t index, uint32_t start)
+{
+	task_struct *p = &task_list[index];
+	uint32_t     j = usec_diff(start, p->Release * 1000); // TMR2 is 0 at the release
+
+#if !SCHED_ABSOLUTE
+	if (!(p->Status & TASK_EVENT) && (j >= p->Period * 1000UL)) 
+		p->Overruns++; // would have been ready again
+#endif
+	if (j > UINT16_MAX) j = UINT16_MAX;
+	if (j > p->Jitter_Max) p->Jitter_Max = (uint16_t)j;
+	avg_add(&p->Jitter_Sum, &p->Jitter_Cnt, (uint16_t)j);
+} // jitter_task()
+#endif
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Idle function of the scheduler, called at the end of dispatch_tasks().
+             If no task is ready and no event is pending, the CPU waits for
+             the next interrupt (WFI). The TMR2 interrupt ends this within 1 msec.
+             The time spent in WFI is accumulated and converted every second 
+             into the CPU load.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void scheduler_idle(void)
+{
+	uint8_t  index = 0;
+	uint32_t time1, time2;
+
+#if SCHED_IDLE_WFI
 	while ((index < MAX_TASKS) && task_list[index].pFunction)
 	{
-		//First go through the initial delay
-		if(task_list[index].Delay > 0)
+		if((task_list[index].Status & (TASK_READY | TASK_ENABLED)) == (TASK_READY | TASK_ENABLED))
+			return; // a task became ready while dispatching, do not sleep
+		index++;
+	} // while
+	if (ev_pending) return; // an event-task has work to do
+	time1 = micros();
+	// A task that becomes ready right here is started after the next interrupt
+	__wait_for_interrupt();
+	time2 = micros();
+	idle_usec += usec_diff(time2, time1);
+	idle_cnt++;
+#else
+	time2 = micros();
+#endif
+	time1 = usec_diff(time2, load_start); // length of current load window
+	if (time1 >= LOAD_WINDOW)
+	{
+		cpu_load   = (uint16_t)(1000 - (idle_usec * 1000) / time1);
+		idle_usec  = 0;
+		load_start = time2;
+	} // if
+} // scheduler_idle()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Update all running software timers with the number of msec.
+             since the previous call. The callback of an expired timer is
+             called from here, so it runs in the context of dispatch_tasks().
+             A repeating timer is reloaded with its Period, corrected for 
+             the time it expired too late.
+  Variables: timer_list[] structure
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void timers_update(void)
+{
+	uint8_t  index;
+	uint16_t late;
+	uint32_t now     = millis();
+	uint32_t elapsed = now - tmr_last;
+
+	if (elapsed == 0) return; // timers already updated in this msec.
+	if (elapsed > 0xFFFF) elapsed = 0xFFFF;
+	tmr_last = now;
+	for (index = 0; index < MAX_TIMERS; index++)
+	{
+		if (timer_list[index].Status & TMR_RUNNING)
 		{
-			task_list[index].Delay--;
-		} // if
-		else
-		{	//now we decrement the actual period counter 
-			task_list[index].Counter--;
-			if(task_list[index].Counter == 0)
+			if (timer_list[index].Remain > elapsed)
 			{
-				//Set the flag and reset the counter;
-				task_list[index].Status |= TASK_READY;
+				timer_list[index].Remain -= (uint16_t)elapsed;
 			} // if
-		} // else
+			else
+			{   // timer expired
+				late = (uint16_t)elapsed - timer_list[index].Remain;
+				if (!(timer_list[index].Status & TMR_REPEAT))
+				     timer_list[index].Remain = 0;
+				else if (timer_list[index].Period > late)
+				     timer_list[index].Remain = timer_list[index].Period - late;
+				else timer_list[index].Remain = 1; // expire again at next update
+				if (!timer_list[index].Remain) timer_list[index].Status &= ~TMR_RUNNING;
+				if (timer_list[index].pFunction) timer_list[index].pFunction();
+			} // else
+		} // if
+	} // for
+} // timers_update()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Make all tasks ready that are bound to one of the events that
+             were posted since the previous call. Called from dispatch_tasks().
+  Variables: ev_pending
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void event_tasks(void)
+{
+	uint8_t index = 0;
+	uint8_t ev;
+
+	if (!ev_pending) return;
+	__disable_interrupt(); // ev_pending is set by all interrupts
+	ev         = ev_pending; // get and clear the posted events
+	ev_pending = 0;
+	__enable_interrupt();
+	TMR2_LOCK(); // Status is also modified by scheduler_isr()
+	while ((index < MAX_TASKS) && task_list[index].pFunction)
+	{
+		if ((task_list[index].Events & ev) && !(task_list[index].Status & TASK_READY))
+		{   // same as release_task(), but no drift: this is not a periodic release
+#if SCHED_JITTER
+			task_list[index].Release = millis();
+#endif
+			task_list[index].Status |= TASK_READY | TASK_EVENT;
+		} // if
 		index++;
 	} // while
-} // scheduler_isr()
+	TMR2_UNLOCK();
+} // event_tasks()
 
 /*-----------------------------------------------------------------------------
   Purpose  : Run all tasks for which the ready flag is set. Should be called 
              from within the main() function, not from an interrupt routine!
+             A task that called task_yield() stays ready and continues at the
+             next call, the other ready tasks run first.
   Variables: task_list[] structure
   Returns  : -
   ---------------------------------------------------------------------------*/
 void dispatch_tasks(void)
 {
 	uint8_t  index = 0;
-	uint32_t time1; // Measured #clock-ticks of 50 usec. (TMR1 frequency)
-	uint32_t time2;
+	uint32_t time1; // Measured #usec. (TMR2 + millisecond counter)
 
+#if SCHED_FOREGROUND
+	scheduler_catchup(); // ready all tasks that timed-out since previous call
+#endif
+	timers_update(); // expired timers call their callback function first
+	event_tasks();   // ready all tasks that wait for a posted event
 	//go through the active tasks
 	while ((index < MAX_TASKS) && task_list[index].pFunction)
 	{
 		if((task_list[index].Status & (TASK_READY | TASK_ENABLED)) == (TASK_READY | TASK_ENABLED))
 		{
-            time1 = millis(); // Read msec. timer
+			time1 = micros(); // Read usec. timer
+			if (!(task_list[index].Status & TASK_YIELD))
+			{   // only for the 1st slice of a task
+#if SCHED_JITTER
+				jitter_task(index, time1);
+#endif
+				task_list[index].Duration = 0; // the slices are added up
+			} // if
+			else task_list[index].Status &= ~TASK_YIELD;
+			cur_task = index;
 			task_list[index].pFunction(); // run the task
-			task_list[index].Status  &= ~TASK_READY; // reset the task when finished
-			task_list[index].Counter  = task_list[index].Period; // reset counter
-			time2 = millis(); // read msec. timer
-			if (time2 < time1) time2 += UINT32_MAX - time1; // overflows every 49.7 days, unlikely
-			else               time2 -= time1; 
-			task_list[index].Duration  = (uint16_t)time2; // time difference in milliseconds
-			if (time2 > task_list[index].Duration_Max)
-			{
-				task_list[index].Duration_Max = time2;
+			cur_task = NO_TASK;
+			time1 = usec_diff(micros(), time1); // duration of this slice
+			if (!(task_list[index].Status & TASK_YIELD))
+			{   // task has finished, not just a slice of it
+				task_list[index].Status  &= ~(TASK_READY | TASK_EVENT); // reset the task when finished
+				task_list[index].Status  |= TASK_RAN;
+#if !SCHED_ABSOLUTE
+#if SCHED_DELTA_QUEUE
+				TMR2_LOCK(); // scheduler_isr() also modifies the delta-queue
+				dq_remove(index); // still queued when the task was made ready by an event
+				dq_insert(index, task_list[index].Period); // back into the delta-queue
+				TMR2_UNLOCK();
+#else
+				task_list[index].Counter  = task_list[index].Period; // reset counter
+#endif
+#endif
 			} // if
+			profile_task(index, time1, !(task_list[index].Status & TASK_YIELD));
 		} // if
 		index++;
 	} // while
-	//go to sleep till next tick!
+#if SCHED_AUTO_PHASE
+	scheduler_stagger_step(); // next chunk of a phase calculation, if any
+#endif
+	scheduler_idle(); // go to sleep till next tick!
 } // dispatch_tasks()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : Called by a running task that wants to continue at the next call
+             of dispatch_tasks(), instead of waiting for its next period. 
+             Normally used with the CR_YIELD() macro of coroutine.h.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void task_yield(void)
+{
+	if (cur_task != NO_TASK) task_list[cur_task].Status |= TASK_YIELD;
+} // task_yield()
+
+#if SCHED_AUTO_PHASE
+/*-----------------------------------------------------------------------------
+  Purpose  : Greatest common divisor of two periods.
+  Variables: a, b: periods in msec.
+  Returns  : gcd(a,b)
+  ---------------------------------------------------------------------------*/
+uint16_t gcd16(uint16_t a, uint16_t b)
+{
+	uint16_t t;
+
+	while (b)
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	} // while
+	return a;
+} // gcd16()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Start a new calculation of the phases (start offsets) of all
+             tasks. The calculation is done in chunks by scheduler_stagger_step(),
+             which dispatch_tasks() calls once per call, so that the tasks do 
+             not have to wait for it. When all tasks are placed, the tasks are
+             restarted with their new phases.
+             Two tasks i and j with phases oi and oj are released at the same
+             tick if (oi - oj) is a multiple of gcd(Pi,Pj). The tasks are 
+             placed one by one, shortest period first. For every task the phase
+             in [0, MAX_PHASE> is chosen with the least number of collisions 
+             with the tasks already placed; with equal collisions the one with
+             the largest free time between the tasks, using the max. measured
+             durations (1 msec. if a task has not run yet).
+             The tasks are released at now + Phase + k * Period. A task that
+             has not been released yet starts one period after now (k = 1), 
+             the initial delay of add_task() is not used. For the other tasks 
+             the next release is the 1st one at or after the current next 
+             release, so a task is never released earlier or more often than
+             with its own period, also not when called again later.
+             Call after all tasks are added and again later when the durations 
+             are known, e.g. from a one-shot timer.
+             Cost: for every task min(Period,MAX_PHASE) phases are tried against
+             all tasks placed before it, at most STAGGER_LOOPS loops per task
+             (less phases are tried for the last tasks). For the 7 tasks in 
+             main() this is about 5100 loops, in chunks of STAGGER_CHUNK loops.
+             The number of loops and the time are shown by list_all_tasks().
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void scheduler_stagger(void)
+{
+	stg_i         = 0; // place the task with the shortest period first
+	stg_o         = 0;
+	stg_best_coll = 0xFFFF;
+	stagger_loops = 0;
+	stagger_usec  = 0;
+} // scheduler_stagger()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Do the next chunk of the calculation started by scheduler_stagger(),
+             see there. It tries phases of one task until STAGGER_CHUNK loops 
+             are done, or it restarts all tasks with their new phases when all 
+             tasks are placed. The task order, durations and the placement 
+             data of the placed tasks are rebuilt in every call, only the 
+             search position is kept between calls.
+  Variables: task_list[] structure
+  Returns  : true = no calculation in progress (any more)
+  ---------------------------------------------------------------------------*/
+bool scheduler_stagger_step(void)
+{
+	uint8_t    i, j, t, n = 0;
+	uint8_t    order[MAX_TASKS];   // tasks in order of placement
+	uint16_t   dur[MAX_TASKS];     // durations in msec. (rounded up)
+	uint16_t   g[MAX_TASKS];       // gcd(Pi,Pj) for task j
+	uint16_t   r[MAX_TASKS];       // (o - oj) mod g[j] for task j
+	uint16_t   oi_max, coll, loops = 0;
+	int32_t    slack, min_slack;
+	uint32_t   now, acc;
+	uint32_t   next[MAX_TASKS];    // ticks until the next release of a task
+	uint32_t   t0;
+
+	if (stg_i == NO_TASK) return true;
+	t0 = micros();
+	while ((n < MAX_TASKS) && task_list[n].pFunction)
+	{
+		dur[n]   = (uint16_t)((task_list[n].Duration_Max + 999) / 1000);
+		if (dur[n] == 0) dur[n] = 1; // not measured yet
+		order[n] = n;
+		n++;
+	} // while
+	for (i = 1; i < n; i++)
+	{   // insertion-sort on period, shortest period is placed first
+		for (j = i; (j > 0) && (task_list[order[j]].Period < task_list[order[j-1]].Period); j--)
+		{
+			t = order[j]; order[j] = order[j-1]; order[j-1] = t;
+		} // for
+	} // for
+	i = stg_i;
+	if (i < n)
+	{   // place task order[i] against order[0]..order[i-1], from phase stg_o on
+		for (j = 0; j < i; j++)
+		{
+			g[j] = gcd16(task_list[order[i]].Period, task_list[order[j]].Period);
+			r[j] = (uint16_t)((g[j] - task_list[order[j]].Phase % g[j] + (uint32_t)stg_o) % g[j]);
+		} // for
+		oi_max = (task_list[order[i]].Period < MAX_PHASE) ? task_list[order[i]].Period : MAX_PHASE;
+		if (i == 0) oi_max = 1; // nothing to compare with: phase 0
+		else if (oi_max > STAGGER_LOOPS / i) oi_max = STAGGER_LOOPS / i;
+		while ((stg_o < oi_max) && (loops < STAGGER_CHUNK))
+		{
+			coll      = 0;
+			min_slack = INT32_MAX;
+			for (j = 0; j < i; j++)
+			{
+				if (r[j] == 0) coll++;
+				// free time after task j has finished and after this task has finished
+				slack = (int32_t)r[j] - dur[order[j]];
+				if ((int32_t)g[j] - r[j] - dur[order[i]] < slack)
+					slack = (int32_t)g[j] - r[j] - dur[order[i]];
+				if (slack < min_slack) min_slack = slack;
+				if (++r[j] == g[j]) r[j] = 0; // value for o + 1
+			} // for j
+			if ((coll < stg_best_coll) || ((coll == stg_best_coll) && (min_slack > stg_best_slack)))
+			{
+				stg_best_coll  = coll;
+				stg_best_slack = min_slack;
+				stg_best_o     = stg_o;
+			} // if
+			stg_o++;
+			loops += i;
+		} // while
+		stagger_loops += loops;
+		if (stg_o >= oi_max)
+		{   // task is placed, continue with the next one in the next call
+			task_list[order[i]].Phase = stg_best_o;
+			stg_i++;
+			stg_o          = 0;
+			stg_best_coll  = 0xFFFF;
+		} // if
+		stagger_usec += usec_diff(micros(), t0);
+		return false;
+	} // if
+
+	TMR2_LOCK(); // scheduler_isr() uses the same data
+#if SCHED_FOREGROUND
+	now = sched_tick; // the delta-queue is relative to the last tick handled
+#else
+	now = millis();
+#endif
+#if SCHED_DELTA_QUEUE
+	for (i = 0; i < n; i++) next[i] = task_list[i].Period; // not queued: requeued after it has run
+	for (i = dq_head, acc = 0; i != NO_TASK; i = task_list[i].Next)
+	{   // the Counters in the delta-queue are relative to the previous task
+		acc    += task_list[i].Counter;
+		next[i] = acc;
+	} // for
+	dq_head = NO_TASK; // rebuild the delta-queue
+#else
+	for (i = 0; i < n; i++) 
+	{   // Counter is 0 only when released and not yet reloaded by dispatch_tasks()
+		if (task_list[i].Counter == 0) next[i] = task_list[i].Period;
+		else next[i] = (uint32_t)task_list[i].Delay + task_list[i].Counter;
+	} // for
+#endif
+	for (i = 0; i < n; i++)
+	{   // next release at now + Phase + k * Period, not before the current one
+		acc = task_list[i].Period;
+		if (!(task_list[i].Status & (TASK_RAN | TASK_READY)))
+			next[i] = acc; // not released yet: 1st release one period from now
+		next[i] += (task_list[i].Phase + acc - next[i] % acc) % acc;
+		if (next[i] > 0xFFFF) next[i] = 0xFFFF; // Period > 32767: not earlier, phase is lost
+#if SCHED_DRIFT
+		task_list[i].Ideal = now + next[i];
+#endif
+#if SCHED_DELTA_QUEUE
+		dq_insert(i, (uint16_t)next[i]);
+#else
+		task_list[i].Delay   = 0;
+		task_list[i].Counter = (uint16_t)next[i];
+#endif
+	} // for
+	TMR2_UNLOCK();
+	stg_i = NO_TASK; // calculation done
+	stagger_usec += usec_diff(micros(), t0);
+	return true;
+} // scheduler_stagger_step()
+#endif
+
 /*-----------------------------------------------------------------------------
   Purpose  : Add a function to the task-list struct. Should be called upon
   		     initialization.
   Variables: task_ptr: pointer to function
              delay   : initial delay in msec.
              period  : period between two calls in msec.
-  Returns  : [NO_ERR, ERR_MAX_TASKS]
+  Returns  : handle of task (index in task_list[]) or NO_TASK if the task-list is full
   ---------------------------------------------------------------------------*/
-uint8_t add_task(void (*task_ptr)(), char *Name, uint16_t delay, uint16_t period)
+uint8_t add_task(void (*task_ptr)(), const char *Name, uint16_t delay, uint16_t period)
 {
 	uint8_t  index = 0;
 	uint16_t temp1 = (uint16_t)(delay  * TICKS_PER_SEC / 1000);
 	uint16_t temp2 = (uint16_t)(period * TICKS_PER_SEC / 1000);
 
-	if (max_tasks >= MAX_TASKS) return ERR_MAX_TASKS;
+	if (max_tasks >= MAX_TASKS) return NO_TASK;
 	//go through the active tasks
 	while ((index < MAX_TASKS) && task_list[index].Period) index++;
-    if (index >= MAX_TASKS)     return ERR_MAX_TASKS;
+    if (index >= MAX_TASKS)     return NO_TASK;
 	//if(task_list[index].Period != 0)
 	//{
 	//	while(task_list[++index].Period != 0) ;
@@ -136,126 +761,387 @@ uint8_t add_task(void (*task_ptr)(), char *Name, uint16_t delay, uint16_t period
 		task_list[index].Counter      = temp2;	        // Countdown timer
 		task_list[index].Delay        = temp1;          // Initial delay before start
 		task_list[index].Status      |= TASK_ENABLED;   // Enable task by default
-		task_list[index].Status      &= ~TASK_READY;    // Task not ready to run
-		task_list[index].Duration     = 0;              // Actual Task Duration
-		task_list[index].Duration_Max = 0;              // Max. Task Duration
-		strncpy(task_list[index].Name, Name, NAME_LEN); // Name of Task
+		task_list[index].Status      &= ~(TASK_READY | TASK_RAN); // Task not ready to run
+		memset(&task_list[index].Duration,0,           // Clear all statistics
+		       sizeof(task_struct) - offsetof(task_struct,Duration));
+		task_list[index].Name         = Name;           // Name of Task
+#if SCHED_DRIFT
+		task_list[index].Ideal        = millis() + temp1 + temp2; // 1st release-time
+#endif
+		task_list[index].Phase        = temp1;          // Initial delay
+		task_list[index].Events       = 0;              // Periodic task only
+#if SCHED_DELTA_QUEUE
+		TMR2_LOCK(); // scheduler_isr() also modifies the delta-queue
+		dq_insert(index, temp1 + temp2); // initial delay + 1st period
+		TMR2_UNLOCK();
+#endif
 		max_tasks++; // increase number of tasks
 	} // if
-	return NO_ERR;
+	return index; // handle of task
 } // add_task()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : Check if a handle refers to a task in the task-list.
+  Variables: handle: handle of task, as returned by add_task()
+  Returns  : true = valid handle
+  ---------------------------------------------------------------------------*/
+bool valid_handle(uint8_t handle)
+{
+	return (handle < MAX_TASKS) && (task_list[handle].Period != 0);
+} // valid_handle()
+
 /*-----------------------------------------------------------------------------
   Purpose  : Enable a task.
-  Variables: Name: Name of task to enable
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Variables: handle: handle of task to enable, as returned by add_task()
+  Returns  : error [NO_ERR, ERR_HANDLE]
   ---------------------------------------------------------------------------*/
-uint8_t enable_task(char *Name)
+uint8_t enable_task(uint8_t handle)
 {
-	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
-	{
-		while ((task_list[index].Period != 0) && !found)
-		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Status |= TASK_ENABLED;
-				found = true;
-			} // if
-			index++;
-		} // while
-	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
+	if (!valid_handle(handle)) return ERR_HANDLE;
+	task_list[handle].Status |= TASK_ENABLED;
+	return NO_ERR;
 } // enable_task()
 
 /*-----------------------------------------------------------------------------
   Purpose  : Disable a task.
-  Variables: Name: Name of task to disable
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Variables: handle: handle of task to disable, as returned by add_task()
+  Returns  : error [NO_ERR, ERR_HANDLE]
   ---------------------------------------------------------------------------*/
-uint8_t disable_task(char *Name)
+uint8_t disable_task(uint8_t handle)
 {
-	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
-	{
-		while ((task_list[index].Period != 0) && !found)
-		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Status &= ~TASK_ENABLED;
-				found = true;
-			} // if
-			index++;
-		} // while
-	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
+	if (!valid_handle(handle)) return ERR_HANDLE;
+	task_list[handle].Status &= ~TASK_ENABLED;
+	return NO_ERR;
 } // disable_task()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : Bind a task to one or more events. The task is also made ready 
+             at the next dispatch_tasks() when one of these events is posted.
+  Variables: handle: handle of task, as returned by add_task()
+             events: EV_* events, 0 = periodic task only
+  Returns  : error [NO_ERR, ERR_HANDLE]
+  ---------------------------------------------------------------------------*/
+uint8_t bind_task_event(uint8_t handle, uint8_t events)
+{
+	if (!valid_handle(handle)) return ERR_HANDLE;
+	task_list[handle].Events = events;
+	return NO_ERR;
+} // bind_task_event()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Post one or more events. Can be called from an interrupt routine
+             and from a task.
+  Variables: events: EV_* events to post
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void event_post(uint8_t events)
+{
+	__istate_t istate = __get_interrupt_state();
+
+	__disable_interrupt(); // read-modify-write of ev_pending
+	ev_pending |= events;
+	__set_interrupt_state(istate);
+} // event_post()
+
 /*-----------------------------------------------------------------------------
   Purpose  : Set the time-period (msec.) of a task.
-  Variables: msec: the time in milliseconds
-             name: the name of the task to set the time for
-  Returns  : error [NO_ERR, ERR_NAME, ERR_EMPTY]
+  Variables: Period: the time in milliseconds
+             handle: handle of task, as returned by add_task()
+  Returns  : error [NO_ERR, ERR_HANDLE, ERR_PERIOD]
   ---------------------------------------------------------------------------*/
-uint8_t set_task_time_period(uint16_t Period, char *Name)
+uint8_t set_task_time_period(uint16_t Period, uint8_t handle)
+{
+	if (!valid_handle(handle)) return ERR_HANDLE;
+	if (Period == 0)           return ERR_PERIOD;
+	task_list[handle].Period = (uint16_t)(Period * TICKS_PER_SEC / 1000);
+	return NO_ERR;
+} // set_task_time_period()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Allocate a software timer from the timer pool. The timer is 
+             not running until timer_start() is called.
+  Variables: tmr_ptr: function to call when the timer expires, NULL = no callback
+  Returns  : handle of timer (index in timer_list[]) or NO_TIMER if the pool is full
+  ---------------------------------------------------------------------------*/
+uint8_t timer_add(void (*tmr_ptr)(void))
 {
 	uint8_t index = 0;
-	bool    found = false;
-	
-	//go through the active tasks
-	if(task_list[index].Period != 0)
+
+	while ((index < MAX_TIMERS) && (timer_list[index].Status & TMR_USED)) index++;
+	if (index >= MAX_TIMERS) return NO_TIMER;
+	timer_list[index].pFunction = tmr_ptr;
+	timer_list[index].Period    = 0;
+	timer_list[index].Remain    = 0;
+	timer_list[index].Status    = TMR_USED;
+	return index; // handle of timer
+} // timer_add()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : (Re)start a software timer. A timer that is already running 
+             starts again with the new time.
+  Variables: handle: handle of timer, as returned by timer_add()
+             msec  : time in msec. until the timer expires
+             repeat: true = restart the timer every msec. until timer_stop()
+  Returns  : error [NO_ERR, ERR_HANDLE, ERR_PERIOD]
+  ---------------------------------------------------------------------------*/
+uint8_t timer_start(uint8_t handle, uint16_t msec, bool repeat)
+{
+	uint32_t pending;
+
+	if ((handle >= MAX_TIMERS) || !(timer_list[handle].Status & TMR_USED))
+		return ERR_HANDLE;
+	if (msec == 0) return ERR_PERIOD;
+	pending = millis() - tmr_last; // not yet handled by timers_update()
+	timer_list[handle].Period  = msec;
+	timer_list[handle].Remain  = (pending < (uint16_t)~msec) ? msec + (uint16_t)pending : 0xFFFF;
+	if (repeat) timer_list[handle].Status |=  TMR_REPEAT;
+	else        timer_list[handle].Status &= ~TMR_REPEAT;
+	timer_list[handle].Status |= TMR_RUNNING;
+	return NO_ERR;
+} // timer_start()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Stop a software timer, its callback function is not called.
+  Variables: handle: handle of timer, as returned by timer_add()
+  Returns  : error [NO_ERR, ERR_HANDLE]
+  ---------------------------------------------------------------------------*/
+uint8_t timer_stop(uint8_t handle)
+{
+	if ((handle >= MAX_TIMERS) || !(timer_list[handle].Status & TMR_USED))
+		return ERR_HANDLE;
+	timer_list[handle].Status &= ~TMR_RUNNING;
+	return NO_ERR;
+} // timer_stop()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Check if a software timer is still counting down. May also be
+             called from an interrupt routine.
+  Variables: handle: handle of timer, as returned by timer_add()
+  Returns  : true = timer is running, false = timer expired or stopped
+  ---------------------------------------------------------------------------*/
+bool timer_running(uint8_t handle)
+{
+	return (handle < MAX_TIMERS) && (timer_list[handle].Status & TMR_RUNNING);
+} // timer_running()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : list all tasks and send result to the UART, one row per call.
+             Row 0 is the phase calculation, row 1 the header and every next
+             row one task. A row is at most REPLY_ROW_MAX bytes.
+  Variables: row: the row to send, start with 0
+ Returns   : true = more rows follow, false = this was the last row
+  ---------------------------------------------------------------------------*/
+bool list_all_tasks(uint8_t row)
+{
+	char         s[60];
+	task_struct *p;
+
+	if (row == 0)
 	{
-		while ((task_list[index].Period != 0) && !found)
-		{
-			if (!strcmp(task_list[index].Name,Name))
-			{
-				task_list[index].Period = (uint16_t)(Period * TICKS_PER_SEC / 1000);
-				found = true;
-			} // if
-			index++;
-		} // while
+#if SCHED_AUTO_PHASE
+		sprintf(s,"Phases: %lu loops, %lu us\n",(unsigned long)stagger_loops,(unsigned long)stagger_usec);
+		xputs(s);
+#endif
+		return true;
 	} // if
-	else return ERR_EMPTY;
-	if (!found)
-	     return ERR_NAME;
-	else return NO_ERR;	
-} // set_task_time_period()
+	if (row == 1)
+	{
+#if SCHED_PROFILING
+		xputs("H,Task-Name,T(ms),Ph(ms),Stat,T(us),Min(us),Avg(us),Max(us),Runs,<100us,<1ms,<10ms,>=10ms\n");
+#else
+		xputs("H,Task-Name,T(ms),Ph(ms),Stat,T(us),Max(us)\n");
+#endif
+	} // if
+	else if (row - 2 < MAX_TASKS)
+	{   // one task
+		p = &task_list[row - 2];
+		if (p->Period == 0) return false;
+#if SCHED_PROFILING
+		sprintf(s,"%d,%s,%u,%u,0x%x,%u,%u,%u,%u,%lu", 
+		          row - 2, p->Name, p->Period, p->Phase, (uint16_t)p->Status, p->Duration, p->Duration_Min,
+		          (uint16_t)(p->Sum_Cnt ? p->Duration_Sum / p->Sum_Cnt : 0),
+		          p->Duration_Max, (unsigned long)p->Runs);
+		xputs(s);
+		sprintf(s,",%u,%u,%u,%u\n",p->Hist[0],p->Hist[1],p->Hist[2],p->Hist[3]);
+#else
+		sprintf(s,"%d,%s,%u,%u,0x%x,%u,%u\n", 
+		          row - 2, p->Name, p->Period, p->Phase, (uint16_t)p->Status, p->Duration, p->Duration_Max);
+#endif
+		xputs(s);
+	} // else if
+	return (row - 1 < MAX_TASKS) && (task_list[row - 1].Period != 0);
+} // list_all_tasks()
+
+#if SCHED_DRIFT
+/*-----------------------------------------------------------------------------
+  Purpose  : list the accumulated drift of the release-time and the number of
+             missed releases of all tasks and send result to the UART, one 
+             row per call. Row 0 is the header, every next row one task.
+  Variables: row: the row to send, start with 0
+ Returns   : true = more rows follow, false = this was the last row
+  ---------------------------------------------------------------------------*/
+bool list_task_timing(uint8_t row)
+{
+	char s[40];
+
+	if (row == 0) xputs("H,Task-Name,Drift(ms),Missed\n");
+	else if ((row - 1 < MAX_TASKS) && (task_list[row - 1].Period != 0))
+	{
+		sprintf(s,"%d,",row - 1);
+		xputs(s);
+		xputs(task_list[row - 1].Name);
+		sprintf(s,",%ld,%u\n",(long)task_list[row - 1].Drift,task_list[row - 1].Missed);
+		xputs(s);
+	} // else if
+	return (row < MAX_TASKS) && (task_list[row].Period != 0);
+} // list_task_timing()
+#else
+/*-----------------------------------------------------------------------------
+  Purpose  : The drift and missed releases are not measured, see SCHED_DRIFT
+             in scheduler.h.
+  Variables: row: the row to send, start with 0
+ Returns   : false, there is only one row
+  ---------------------------------------------------------------------------*/
+bool list_task_timing(uint8_t row)
+{
+	xputs("Drift off, see SCHED_DRIFT\n");
+	return false;
+} // list_task_timing()
+#endif
+
+#if SCHED_JITTER
+/*-----------------------------------------------------------------------------
+  Purpose  : list the release-jitter (time between release and start of a
+             task) and the number of overruns of all tasks and send result 
+             to the UART, one row per call. Row 0 is the header, every next
+             row one task.
+  Variables: row: the row to send, start with 0
+ Returns   : true = more rows follow, false = this was the last row
+  ---------------------------------------------------------------------------*/
+bool list_task_jitter(uint8_t row)
+{
+	char         s[40];
+	task_struct *p;
+
+	if (row == 0) xputs("H,Task-Name,Avg(us),Max(us),Overruns\n");
+	else if ((row - 1 < MAX_TASKS) && (task_list[row - 1].Period != 0))
+	{
+		p = &task_list[row - 1];
+		sprintf(s,"%d,",row - 1);
+		xputs(s);
+		xputs(p->Name);
+		sprintf(s,",%u,%u,%u\n",(uint16_t)(p->Jitter_Cnt ? p->Jitter_Sum / p->Jitter_Cnt : 0),
+		                        p->Jitter_Max, p->Overruns);
+		xputs(s);
+	} // else if
+	return (row < MAX_TASKS) && (task_list[row].Period != 0);
+} // list_task_jitter()
+#else
+/*-----------------------------------------------------------------------------
+  Purpose  : The release-jitter and overruns are not measured, see 
+             SCHED_JITTER in scheduler.h.
+  Variables: row: the row to send, start with 0
+ Returns   : false, there is only one row
+  ---------------------------------------------------------------------------*/
+bool list_task_jitter(uint8_t row)
+{
+	xputs("Jitter off, see SCHED_JITTER\n");
+	return false;
+} // list_task_jitter()
+#endif
 
 /*-----------------------------------------------------------------------------
-  Purpose  : list all tasks and send result to the UART.
+  Purpose  : Send the CPU load and idle statistics to the UART.
   Variables: -
  Returns   : -
   ---------------------------------------------------------------------------*/
-void list_all_tasks(void)
+void print_cpu_load(void)
 {
-	uint8_t index = 0;
-	char    s[50];
+	char s[40];
 
-	xputs("Task-Name,T(ms),Stat,T(ms),M(ms)\n");
-	//go through the active tasks
-	if(task_list[index].Period != 0)
+	sprintf(s,"CPU load:%u.%u %%, ",cpu_load/10, cpu_load%10);
+	xputs(s);
+	sprintf(s,"WFI:%lu, Uptime:%lu s\n",(unsigned long)idle_cnt,(unsigned long)uptime_sec());
+	xputs(s);
+} // print_cpu_load()
+
+#if ISR_TIMING
+/*-----------------------------------------------------------------------------
+  Purpose  : Update the timing statistics of an interrupt routine. Called 
+             at the end of an interrupt routine with the ISR_EXIT() macro.
+  Variables: id: the interrupt routine [ISR_TMR2, ISR_UART_TX, ISR_UART_RX]
+             t0: value of TMR2 at the start of the interrupt routine
+ Returns   : -
+  ---------------------------------------------------------------------------*/
+void isr_stat(uint8_t id, uint16_t t0)
+{
+	isr_struct *p = &isr_list[id];
+	uint16_t    d = tmr2_val();
+
+	if (d < t0) d += 1001; // TMR2 counts from 0 to 1000
+	d -= t0;
+	if ((p->Calls == 0) || (d < p->Min)) p->Min = d;
+	if (d > p->Max) p->Max = d;
+	p->Sum += d;
+	p->Calls++;
+} // isr_stat()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : list the timing statistics of all interrupt routines since the 
+             previous call and send result to the UART, one row per call.
+             Row 0 is the header, every next row one interrupt routine. The
+             statistics of an interrupt routine are cleared when its row is
+             sent, isr_start[] keeps the start time for every routine.
+             The load in 0.1 % is the same as the ISR-time in usec. per msec.
+  Variables: row: the row to send, start with 0
+ Returns   : true = more rows follow, false = this was the last row
+  ---------------------------------------------------------------------------*/
+bool list_isr_timing(uint8_t row)
+{
+	uint8_t    i = row - 1;
+	char       s[50];
+	uint32_t   msec, load;
+	mono_time  now;
+	isr_struct isr;
+
+	if (row == 0) 
 	{
-		while ((index < MAX_TASKS) && (task_list[index].Period != 0))
-		{
-            xputs(task_list[index].Name);
-            
-            sprintf(s,",%u,0x%x,%d,%d\n", 
-                      task_list[index].Period  , (uint16_t)task_list[index].Status, 
-                      task_list[index].Duration, task_list[index].Duration_Max);
-	    xputs(s);
-            index++;
-		} // while
+		xputs("ISR,Calls/s,Min(us),Avg(us),Max(us),Load(%)\n");
+		return true;
 	} // if
-} // list_all_tasks()
+	if (i >= NR_ISRS) return false;
+	time_now(&now);
+	__disable_interrupt(); // get a consistent copy and clear the statistics
+	isr = isr_list[i];
+	memset(&isr_list[i], 0x00, sizeof(isr_struct));
+	__enable_interrupt();
+	// s7 may be sent after more than 49.7 days: millis() would have wrapped
+	if ((uint16_t)(now.epoch - isr_start[i].epoch) > 1 ||
+	    ((now.epoch != isr_start[i].epoch) && (now.msec >= isr_start[i].msec)))
+	     msec = 0xFFFFFFFF; // 2^32 msec. or longer, clip
+	else msec = now.msec - isr_start[i].msec;
+	isr_start[i] = now;
+	if (msec == 0) msec = 1;
+	xputs(isr_name[i]);
+	sprintf(s,",%lu,%u,%u,%u,",(unsigned long)((isr.Calls < 4000000L) ? isr.Calls * 1000 / msec
+	                                                                   : isr.Calls / (msec / 1000)), isr.Min,
+	        (uint16_t)(isr.Calls ? isr.Sum / isr.Calls : 0), isr.Max);
+	xputs(s);
+	load = isr.Sum / msec; // usec/msec = 0.1 %, no overflow for long intervals
+	sprintf(s,"%lu.%lu\n",(unsigned long)(load / 10), (unsigned long)(load % 10));
+	xputs(s);
+	return (row < NR_ISRS);
+} // list_isr_timing()
+#else
+/*-----------------------------------------------------------------------------
+  Purpose  : The timing of the interrupt routines is not measured, see 
+             ISR_TIMING in scheduler.h.
+  Variables: row: the row to send, start with 0
+ Returns   : false, there is only one row
+  ---------------------------------------------------------------------------*/
+bool list_isr_timing(uint8_t row)
+{
+	xputs("ISR timing off, see ISR_TIMING\n");
+	return false;
+} // list_isr_timing()
+#endif
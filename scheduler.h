@@ -25,38 +25,183 @@
 #include <stdbool.h>
 #include <string.h>
 
-#define MAX_TASKS	  (4)
+// The configuration switches below can be overruled from the compiler 
+// command-line, e.g. by the host benchmarks in the test directory.
+#ifndef MAX_TASKS
+#define MAX_TASKS	  (7)
+#endif
 #define MAX_MSEC      (60000)
 #define TICKS_PER_SEC (1000L) /* 1000: 1 kHz interrupt frequency */
-#define NAME_LEN         (12) 
+
+// 1 = delta-queue: tasks are kept in a list sorted by time-to-next-run and 
+//     scheduler_isr() only decrements the head of the list (O(1) per tick).
+// 0 = scheduler_isr() decrements the counters of all tasks every tick.
+#ifndef SCHED_DELTA_QUEUE
+#define SCHED_DELTA_QUEUE (1)
+#endif
+#define NO_TASK        (0xFF) /* End-of-list marker for the delta-queue */
+
+// 1 = absolute-deadline: the next release-time of a task is calculated from its
+//     previous release-time, so task-duration and dispatch latency do not add up.
+// 0 = the period counter is reloaded after the task has finished.
+#ifndef SCHED_ABSOLUTE
+#define SCHED_ABSOLUTE    (1)
+#endif
+
+// 1 = the TMR2 interrupt only updates the millisecond counter (and the display),
+//     dispatch_tasks() handles all ticks since its previous call.
+// 0 = the TMR2 interrupt calls scheduler_isr() every tick.
+#define SCHED_FOREGROUND  (1)
+
+// 1 = dispatch_tasks() executes WFI (wait for interrupt) when no task is ready
+//     and no event is pending. The time spent there is used for the CPU load.
+#define SCHED_IDLE_WFI    (1)
+#define LOAD_WINDOW  (1000000L) /* CPU load is calculated every second (in usec.) */
+
+// 1 = scheduler_stagger() replaces the initial delays of add_task() by phases
+//     (start offsets) that minimise the number of tasks released at the same
+//     tick, using the periods and measured durations of all tasks.
+#define SCHED_AUTO_PHASE  (1)
+#define MAX_PHASE     (1000) /* Phases are searched within the 1st second */
+#define STAGGER_LOOPS (1000) /* max. loops of the phase search for one task */
+#define STAGGER_CHUNK  (100) /* max. loops of the phase search per dispatch_tasks() */
+
+// Optional statistics of every task, each switch adds fields to task_struct.
+// The last and max. duration (s2) are always measured, scheduler_stagger() needs them.
+// SCHED_PROFILING: min., average duration, runs and histogram (s2), 20 bytes per task
+// SCHED_DRIFT    : drift of the release-time and missed releases (s5), 10 bytes per task
+// SCHED_JITTER   : release-jitter and overruns (s6), 14 bytes per task
+#ifndef SCHED_PROFILING
+#define SCHED_PROFILING   (0)
+#endif
+#ifndef SCHED_DRIFT
+#define SCHED_DRIFT       (0)
+#endif
+#ifndef SCHED_JITTER
+#define SCHED_JITTER      (0)
+#endif
+
+// Bins of the task-duration histogram: <100 usec, <1 msec, <10 msec, >=10 msec.
+#define PROF_BINS        (4)
 
 #define TASK_READY    (0x01)
 #define TASK_ENABLED  (0x02)
+#define TASK_YIELD    (0x04) /* task called task_yield(), continue at next dispatch */
+#define TASK_EVENT    (0x08) /* task was made ready by an event, not by its period */
+#define TASK_RAN      (0x10) /* task has finished at least once */
+
+// Software timers: one-shot or repeating countdown timers with an optional
+// callback. They are updated from dispatch_tasks(), not from the interrupt.
+#define MAX_TIMERS       (4)
+#define NO_TIMER      (0xFF) /* timer_add(): timer-pool is full */
+#define TMR_USED      (0x01) /* timer is allocated by timer_add() */
+#define TMR_RUNNING   (0x02) /* timer is counting down */
+#define TMR_REPEAT    (0x04) /* timer is restarted with Period when it expires */
+
+// Events: posted by an interrupt routine with event_post(). A task that is
+// bound to an event with bind_task_event() becomes ready at the next call of 
+// dispatch_tasks(), in addition to its periodic releases.
+#define EV_UART_LINE  (0x01) /* UART: command line received */
+#define EV_BUTTON     (0x02) /* Keys: key pressed, released or auto-repeated */
+
+// ISR timing statistics, measured with TMR2 (1 usec. resolution). Use ISR_ENTER()
+// as the first and ISR_EXIT() as the last statement of an interrupt routine.
+// 1 = measure every interrupt routine, shown with UART command s7. This costs
+//     2 reads of TMR2 per interrupt and 48 bytes of RAM.
+// 0 = ISR_ENTER() and ISR_EXIT() are empty.
+#ifndef ISR_TIMING
+#define ISR_TIMING        (0)
+#endif
+#define ISR_TMR2      (0)
+#define ISR_UART_TX   (1)
+#define ISR_UART_RX   (2)
+#define NR_ISRS       (3)
+#if ISR_TIMING
+#define ISR_ENTER()   uint16_t isr_t0 = tmr2_val()
+#define ISR_EXIT(id)  isr_stat(id, isr_t0)
+#else
+#define ISR_ENTER()
+#define ISR_EXIT(id)
+#endif
 
 #define NO_ERR        (0x00)
 #define ERR_MAX_TASKS (0x03)
-#define ERR_NAME      (0x04)
-#define ERR_EMPTY     (0x05)
+#define ERR_HANDLE    (0x04)
+#define ERR_PERIOD    (0x05) /* a period or time of 0 msec. */
 
 typedef struct _task_struct
 {
 	void     (* pFunction)(void); // Function pointer
-	char     Name[NAME_LEN];      // Task name
+	const char *Name;             // Task name, in flash. Only used by list_all_tasks()
 	uint16_t Period;              // Period between 2 calls in msec.
 	uint16_t Delay;               // Initial delay before Counter starts in msec.
-	uint16_t Counter;             // Running counter, is init. from Period
-	uint8_t	 Status;              // bit 1: 1=enabled ; bit 0: 1=ready to run
-	uint16_t Duration;            // Measured task-duration in clock-ticks
-	uint16_t Duration_Max;        // Max. measured task-duration
+	uint16_t Counter;             // Running counter, is init. from Period. Delta-queue: #ticks after previous task
+	uint8_t  Next;                // Delta-queue: index of next task in queue, NO_TASK = end of queue
+	uint8_t	 Status;              // bit 4: 1=has run ; bit 3: 1=event ; bit 2: 1=yielded ; bit 1: 1=enabled ; bit 0: 1=ready to run
+	uint8_t  Events;              // Events (EV_*) that make this task ready
+	uint16_t Phase;               // Start offset in msec. (initial delay or from scheduler_stagger())
+	// Statistics: keep at the end of the struct, cleared by add_task()
+	uint16_t Duration;            // Last measured task-duration in usec. (coroutine: sum of its slices)
+	uint16_t Duration_Max;        // Max. measured task-duration in usec.
+#if SCHED_PROFILING
+	uint16_t Duration_Min;        // Min. measured task-duration in usec.
+	uint32_t Duration_Sum;        // Sum of task-durations, for the average
+	uint16_t Sum_Cnt;             // Number of task-durations in Duration_Sum
+	uint32_t Runs;                // Number of times the task has run
+	uint16_t Hist[PROF_BINS];     // Histogram of task-durations
+#endif
+#if SCHED_DRIFT
+	uint32_t Ideal;               // Ideal (drift-free) next release-time in msec.
+	int32_t  Drift;               // Accumulated drift of the release-time in msec.
+	uint16_t Missed;              // Periodic releases while the task was still ready from the previous one
+#endif
+#if SCHED_JITTER
+	uint32_t Release;             // Release-time in msec.: time when TASK_READY was set
+	uint16_t Overruns;            // Task started a period or more after its release (not with SCHED_ABSOLUTE)
+	uint16_t Jitter_Max;          // Max. time between release and start of task in usec.
+	uint32_t Jitter_Sum;          // Sum of release-jitter, for the average
+	uint16_t Jitter_Cnt;          // Number of release-jitters in Jitter_Sum
+#endif
 } task_struct;
 
+typedef struct _timer_struct
+{
+	void     (* pFunction)(void); // Callback function when timer expires, may be NULL
+	uint16_t Period;              // Reload value in msec. for a repeating timer
+	uint16_t Remain;              // msec. remaining until the timer expires
+	uint8_t  Status;              // bit 2: 1=repeating ; bit 1: 1=running ; bit 0: 1=allocated
+} timer_struct;
+
+typedef struct _isr_struct
+{
+	uint16_t Min;                 // Min. ISR-duration in usec.
+	uint16_t Max;                 // Max. ISR-duration in usec.
+	uint32_t Sum;                 // Sum of ISR-durations, for the average and ISR-load
+	uint32_t Calls;               // Number of times the ISR was called
+} isr_struct;
+
 void    scheduler_init(void); // clear task_list struct
 void    scheduler_isr(void);  // run-time function for scheduler
+void    scheduler_catchup(void); // run-time function for scheduler in foreground
 void    dispatch_tasks(void); // run all tasks that are ready
-uint8_t add_task(void (*task_ptr)(), char *Name, uint16_t delay, uint16_t period);
-uint8_t set_task_time_period(uint16_t Period, char *Name);
-uint8_t enable_task(char *Name);
-uint8_t disable_task(char *Name);
-void    list_all_tasks(void);
+void    task_yield(void);     // continue current task at next dispatch_tasks()
+void    scheduler_stagger(void); // start a calculation of the phases of all tasks
+bool    scheduler_stagger_step(void);
+uint8_t add_task(void (*task_ptr)(), const char *Name, uint16_t delay, uint16_t period);
+uint8_t set_task_time_period(uint16_t Period, uint8_t handle);
+uint8_t enable_task(uint8_t handle);
+uint8_t disable_task(uint8_t handle);
+uint8_t bind_task_event(uint8_t handle, uint8_t events);
+void    event_post(uint8_t events);
+uint8_t timer_add(void (*tmr_ptr)(void));
+uint8_t timer_start(uint8_t handle, uint16_t msec, bool repeat);
+uint8_t timer_stop(uint8_t handle);
+bool    timer_running(uint8_t handle);
+bool    list_all_tasks(uint8_t row);   // one row per call, see rs232_task()
+bool    list_task_timing(uint8_t row);
+bool    list_task_jitter(uint8_t row);
+void    print_cpu_load(void);
+void    isr_stat(uint8_t id, uint16_t t0);
+bool    list_isr_timing(uint8_t row);
 
 #endif
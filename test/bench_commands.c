@@ -0,0 +1,157 @@
+/*==================================================================
+  File Name    : bench_commands.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host benchmark of the UART command parser of comms.c for
+            every command:
+            - old    : process_string() and the strcmp() chain with the
+                       switch for 1-letter commands, as they were before
+                       cmd_list[] (only the lookup, copied here).
+            - lookup : process_string() and find_command().
+            - execute: execute_single_command(), parse and dispatch with
+                       the handler (the output is not sent).
+            The result is in CPU cycles (time-stamp counter) of the PC per
+            command, only useful to compare.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "uart.h"
+#include "comms.h"
+
+#define LOOPS (1000000UL) /* number of times every command is parsed */
+
+uint8_t process_string(char *s, char *s1, uint16_t *d1, uint16_t *d2);
+
+// All commands of cmd_list[] that do not read or write memory directly
+char lines[][UART_BUFLEN] = {"sp", "sp=120", "pid", "pid=250", "te 9", "td 9",
+                             "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8",
+                             "s9", "p3", "p6", "v12=300", "e1", "h", "xyz"};
+#define NR_LINES (sizeof(lines) / sizeof(lines[0]))
+
+volatile uint32_t sink; // keeps the compiler from removing the lookups
+
+// The output of the handlers and the UART functions they use are not needed
+void  xputs(const char *s)    { sink += s[0]; }
+void  uart_print_stats(void)  { }
+char *uart_get_line(void)     { return NULL; }
+void  uart_line_done(void)    { }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : process_string() before cmd_list[], with strlen() and a copy of the name
+  ---------------------------------------------------------------------------*/
+uint8_t old_process_string(char *s, char *s1, uint16_t *d1, uint16_t *d2)
+{
+    uint8_t i = 0;
+    uint8_t len = strlen(s);
+    
+    s1[0] = '\0';
+    *d1   = *d2 = 0;
+    while ((i < len) && (s[i] != ' ') && (s[i] != '=')) i++;
+    memcpy(s1,s,i);  // copy command into 1st string
+    s1[i] = '\0';    // terminate string
+    if (i >= len) return 1; // only 1 item in command
+    else if (s[i] == '=')
+    {
+        *d1 = (uint16_t)strtol(&s[i+1],NULL,10);
+        return 2; // 2 items, return 2nd substring as a decimal number
+    } // if
+    *d1 = (uint16_t)strtol(&s[++i],NULL,16); // address in hex
+    while ((i < len) && (s[i] != ' ')) i++;  // find next space
+    if (i >= len) return 2;                  // no more data
+    *d2 = (uint16_t)strtol(&s[i+1],NULL,16); // data in hex
+    return 3;
+} // old_process_string()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The lookup of execute_single_command() before cmd_list[]
+  Variables: s: the command line
+  Returns  : number of the command, 0 = not found
+  ---------------------------------------------------------------------------*/
+uint8_t old_lookup(char *s)
+{
+    uint8_t  num = atoi(&s[1]);
+    char     s3[10];
+    uint16_t d1,d2;
+
+    if (isalpha(s[1]))
+    {   // 2-character command
+        old_process_string(s,s3,&d1,&d2);
+        if      (!strcmp(s3,"sp"))  return 1;
+        else if (!strcmp(s3,"pid")) return 2;
+        else if (!strcmp(s3,"rb"))  return 3;
+        else if (!strcmp(s3,"rw"))  return 4;
+        else if (!strcmp(s3,"wb"))  return 5;
+        else if (!strcmp(s3,"ww"))  return 6;
+        else if (!strcmp(s3,"te"))  return 7;
+        else if (!strcmp(s3,"td"))  return 8;
+        return 0;
+    } // if
+    switch (s[0])
+    {   // single letter command
+        case 'p': return 9;
+        case 's': return (num <= 9) ? 10 + num : 0;
+        case 'e': return 20;
+        case 'v': old_process_string(s,s3,&d1,&d2);
+                  return 21;
+        default : return 0;
+    } // switch
+} // old_lookup()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The lookup with cmd_list[]
+  Variables: s: the command line
+  Returns  : pointer to the command or NULL if not found
+  ---------------------------------------------------------------------------*/
+const cmd_struct *new_lookup(char *s)
+{
+    char     s3[UART_BUFLEN];
+    uint16_t d1,d2;
+
+    process_string(s,s3,&d1,&d2);
+    return find_command(s3);
+} // new_lookup()
+
+int main(void)
+{
+    uint32_t i;
+    uint8_t  j;
+    uint64_t t_old, t_new, t_exe, t, t_sum[3] = {0};
+
+    printf("%-8s %8s %8s %8s  (cycles/command)\n", "command", "old", "lookup", "execute");
+    for (j = 0; j < NR_LINES; j++)
+    {
+        t = host_cycles();
+        for (i = 0; i < LOOPS; i++) sink += old_lookup(lines[j]);
+        t_old = host_cycles() - t;
+        t = host_cycles();
+        for (i = 0; i < LOOPS; i++) sink += (new_lookup(lines[j]) != NULL);
+        t_new = host_cycles() - t;
+        t = host_cycles();
+        for (i = 0; i < LOOPS; i++) sink += execute_single_command(lines[j], 0);
+        t_exe = host_cycles() - t;
+        printf("%-8s %8.1f %8.1f %8.1f\n", lines[j], (double)t_old / LOOPS,
+               (double)t_new / LOOPS, (double)t_exe / LOOPS);
+        t_sum[0] += t_old;
+        t_sum[1] += t_new;
+        t_sum[2] += t_exe;
+    } // for
+    printf("%-8s %8.1f %8.1f %8.1f\n", "average", (double)t_sum[0] / (LOOPS * NR_LINES),
+           (double)t_sum[1] / (LOOPS * NR_LINES), (double)t_sum[2] / (LOOPS * NR_LINES));
+    return 0;
+} // main()
@@ -0,0 +1,73 @@
+/*==================================================================
+  File Name    : bench_ring_buffer.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host throughput benchmark for the ring-buffers of
+            ring_buffer.h: one element at a time (put/get, as used by
+            the UART interrupts) and in blocks (write/read).
+            The numbers are for the PC, only useful to compare versions.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include "host.h"
+#include "ring_buffer.h"
+
+#define BYTES (50000000UL) /* number of bytes through the buffer */
+#define BLOCK (16)         /* block size for write/read */
+
+RING_BUFFER_DEF(rb, uint8_t, 128) /* same size as the UART TX buffer */
+
+struct rb r;
+volatile uint8_t sink; // keeps the compiler from removing the reads
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Print the result of a benchmark
+  Variables: name: name of the benchmark
+             ns  : time for BYTES bytes in nsec.
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void report(const char *name, uint64_t ns)
+{
+    printf("%-22s: %6.2f nsec./byte, %7.1f Mbyte/s\n", name,
+           (double)ns / BYTES, (double)BYTES * 1000.0 / ns);
+} // report()
+
+int main(void)
+{
+    uint8_t  buf[BLOCK];
+    uint32_t i;
+    uint8_t  j, x = 0;
+    uint64_t t;
+
+    rb_init(&r);
+    t = host_nsec();
+    for (i = 0; i < BYTES; i += BLOCK)
+    {   // fill half the buffer, then empty it
+        for (j = 0; j < BLOCK; j++) rb_put(&r, (uint8_t)j);
+        for (j = 0; j < BLOCK; j++) x += rb_get(&r);
+    } // for
+    report("put/get", host_nsec() - t);
+
+    for (j = 0; j < BLOCK; j++) buf[j] = j;
+    t = host_nsec();
+    for (i = 0; i < BYTES; i += BLOCK)
+    {
+        rb_write(&r, buf, BLOCK);
+        rb_read(&r, buf, BLOCK);
+    } // for
+    report("write/read (16 bytes)", host_nsec() - t);
+    sink = x + buf[0];
+    return 0;
+} // main()
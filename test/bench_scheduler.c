@@ -0,0 +1,100 @@
+/*==================================================================
+  File Name    : bench_scheduler.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host benchmark of the work per tick of scheduler_isr() for
+            4, 16 and 32 tasks. The Makefile builds it twice: with the
+            delta-queue (SCHED_DELTA_QUEUE=1) and with the counter of
+            every task decremented every tick (SCHED_DELTA_QUEUE=0).
+            The times are for the PC, compare the two builds and the
+            growth with the number of tasks, not the absolute values.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include "host.h"
+#include "scheduler.h"
+
+#define TICKS (2000000UL) /* 2000 seconds of 1 msec. ticks */
+
+extern volatile uint32_t t2_millis;
+extern uint8_t           max_tasks;
+extern uint32_t          stagger_loops;
+
+// Periods of the tasks in msec., used round-robin. Like the tasks in main(),
+// most ticks do not release a task.
+const uint16_t periods[] = {100, 200, 250, 500, 1000, 2000, 5000, 60000};
+
+void dummy_task(void) { }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Measure the average time of scheduler_isr() for n tasks
+  Variables: n: number of tasks [1..MAX_TASKS]
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void bench_tasks(uint8_t n)
+{
+    uint8_t  i;
+    uint32_t tick;
+    uint64_t t;
+
+    t2_millis = 0;
+    max_tasks = 0;
+    scheduler_init();
+    for (i = 0; i < n; i++)
+        add_task(dummy_task, "dummy", i * 7, periods[i % 8]);
+    t = host_nsec();
+    for (tick = 0; tick < TICKS; tick++)
+    {
+        t2_millis++;
+        scheduler_isr();
+    } // for
+    t = host_nsec() - t;
+    printf("%2d tasks: %6.1f nsec./tick\n", n, (double)t / TICKS);
+} // bench_tasks()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Measure scheduler_stagger() for the 7 tasks of main()
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void bench_stagger(void)
+{
+    const uint16_t period[7] = {500, 100, 100, 1000, 60000, 1000, 1000};
+    uint8_t  i;
+    uint16_t chunks;
+    uint64_t t;
+
+    t2_millis = 0;
+    max_tasks = 0;
+    scheduler_init();
+    for (i = 0; i < 7; i++) add_task(dummy_task, "dummy", 0, period[i]);
+    t = host_nsec();
+    scheduler_stagger();
+    for (chunks = 1; !scheduler_stagger_step(); chunks++) ;
+    t = host_nsec() - t;
+    printf("scheduler_stagger(), 7 tasks: %lu loops in %u chunks, %.1f usec.\n",
+           (unsigned long)stagger_loops, chunks, (double)t / 1000);
+} // bench_stagger()
+
+int main(void)
+{
+    printf("scheduler_isr(), SCHED_DELTA_QUEUE=%d, SCHED_ABSOLUTE=%d\n",
+           SCHED_DELTA_QUEUE, SCHED_ABSOLUTE);
+    bench_tasks(4);
+    bench_tasks(16);
+    bench_tasks(32);
+    bench_stagger();
+    return 0;
+} // main()
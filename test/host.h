@@ -0,0 +1,67 @@
+/*==================================================================
+  File Name    : host.h
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Helpers for the host (PC) tests and benchmarks: a check
+            macro that counts the failures, a nanosecond clock and a
+            cycle counter.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#ifndef _HOST_H
+#define _HOST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+int host_fails = 0; // number of failed CHECK()s
+
+// Check a condition, print file and line when it fails
+#define CHECK(c) do { if (!(c)) { host_fails++; \
+                      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); } } while (0)
+
+// Print the result of a test program, returns the exit-code for main()
+#define CHECK_DONE(name) (printf("%s: %s\n", name, host_fails ? "FAILED" : "ok"), host_fails ? 1 : 0)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Monotonic time for the benchmarks
+  Variables: -
+  Returns  : time in nanoseconds
+  ---------------------------------------------------------------------------*/
+static inline uint64_t host_nsec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} // host_nsec()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : CPU clock cycles for the benchmarks, independent of the clock
+             frequency of the PC. Without a cycle counter it returns nsec.
+  Variables: -
+  Returns  : number of cycles
+  ---------------------------------------------------------------------------*/
+static inline uint64_t host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return host_nsec();
+#endif
+} // host_cycles()
+
+#endif
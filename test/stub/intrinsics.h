@@ -0,0 +1,26 @@
+/*==================================================================
+  File Name    : intrinsics.h
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host (PC) replacement of the IAR STM8 intrinsics, for the
+            tests and benchmarks in the test directory only. The
+            interrupt state is a variable, so a test can check it.
+  ==================================================================
+*/
+#ifndef _STUB_INTRINSICS_H
+#define _STUB_INTRINSICS_H
+
+#include <stdint.h>
+
+typedef uint8_t __istate_t;
+
+extern volatile __istate_t stub_istate; // 1 = interrupts enabled
+
+#define __get_interrupt_state()   (stub_istate)
+#define __set_interrupt_state(s)  (stub_istate = (s))
+#define __disable_interrupt()     (stub_istate = 0)
+#define __enable_interrupt()      (stub_istate = 1)
+#define __wait_for_interrupt()    ((void)0)
+#define __no_operation()          ((void)0)
+
+#endif
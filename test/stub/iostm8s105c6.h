@@ -0,0 +1,45 @@
+/*==================================================================
+  File Name    : iostm8s105c6.h
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host (PC) replacement of the IAR STM8S105C6 register
+            definitions, for the tests and benchmarks in the test
+            directory only. Every register (bit) is a variable that is
+            defined in stub_hw.c. Only the registers used by the
+            tested source files are here.
+  ==================================================================
+*/
+#ifndef _STUB_IOSTM8S105C6_H
+#define _STUB_IOSTM8S105C6_H
+
+#include <stdint.h>
+
+#define __interrupt            /* ISRs are normal functions on the host */
+
+extern volatile uint8_t TIM2_IER_UIE;
+extern volatile uint8_t TIM2_SR1_UIF;
+extern volatile uint8_t TIM2_CNTRH;
+extern volatile uint8_t TIM2_CNTRL;
+extern volatile uint8_t UART2_BRR1;
+extern volatile uint8_t UART2_BRR2;
+extern volatile uint8_t UART2_CR1;
+extern volatile uint8_t UART2_CR1_M;
+extern volatile uint8_t UART2_CR1_PCEN;
+extern volatile uint8_t UART2_CR2;
+extern volatile uint8_t UART2_CR2_REN;
+extern volatile uint8_t UART2_CR2_RIEN;
+extern volatile uint8_t UART2_CR2_TEN;
+extern volatile uint8_t UART2_CR2_TIEN;
+extern volatile uint8_t UART2_CR3;
+extern volatile uint8_t UART2_CR3_CKEN;
+extern volatile uint8_t UART2_CR3_CPHA;
+extern volatile uint8_t UART2_CR3_CPOL;
+extern volatile uint8_t UART2_CR3_LBCL;
+extern volatile uint8_t UART2_CR3_STOP;
+extern volatile uint8_t UART2_CR4;
+extern volatile uint8_t UART2_DR;
+extern volatile uint8_t UART2_GTR;
+extern volatile uint8_t UART2_PSCR;
+extern volatile uint8_t UART2_SR;
+
+#endif
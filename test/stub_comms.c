@@ -0,0 +1,41 @@
+/*==================================================================
+  File Name    : stub_comms.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host replacements for the functions and variables that
+            comms.c uses from the other parts of the firmware: the
+            eeprom, the I2C bus and the variables of w3230_main.c.
+            Every I2C address answers, to get the longest replies.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart.h"
+
+char     version[]    = "W3230-stm8s105c6 host\n";
+int16_t  setpoint     = 0;
+int16_t  temp1_ow_10  = 0;
+uint8_t  temp1_ow_err = 0;
+bool     pid_sw       = false;
+int16_t  pid_fx       = 0;
+uint16_t eep[256];          // contents of the eeprom, set by the test
+
+uint16_t eeprom_read_config(uint8_t eeprom_address)          { return eep[eeprom_address]; }
+void     eeprom_write_config(uint8_t eeprom_address, uint16_t data) { eep[eeprom_address] = data; }
+uint8_t  i2c_start_bb(uint8_t addr) { return 0; } // I2C_ACK
+void     i2c_stop_bb(void)          { }
+uint16_t divu10(uint16_t n)         { return n / 10; }
+void     print_render_stats(void)   { xputs("Render: 0, skipped: 0\n"); }
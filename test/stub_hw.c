@@ -0,0 +1,53 @@
+/*==================================================================
+  File Name    : stub_hw.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host (PC) replacement of the STM8 registers and of the
+            functions of delay.c and uart.c that the tested source
+            files need. The time only advances when a test changes
+            t2_millis, so the tests are repeatable.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <intrinsics.h>
+#include <iostm8s105c6.h>
+#include "delay.h"
+
+volatile __istate_t stub_istate  = 1; // interrupts enabled
+volatile uint8_t    TIM2_IER_UIE = 1;
+volatile uint8_t    TIM2_SR1_UIF = 0;
+volatile uint8_t    TIM2_CNTRH   = 0;
+volatile uint8_t    TIM2_CNTRL   = 0;
+volatile uint8_t    UART2_BRR1, UART2_BRR2, UART2_CR1, UART2_CR1_M, UART2_CR1_PCEN, UART2_CR2,
+                    UART2_CR2_REN, UART2_CR2_RIEN, UART2_CR2_TEN, UART2_CR2_TIEN,
+                    UART2_CR3, UART2_CR3_CKEN, UART2_CR3_CPHA, UART2_CR3_CPOL,
+                    UART2_CR3_LBCL, UART2_CR3_STOP, UART2_CR4, UART2_DR,
+                    UART2_GTR, UART2_PSCR, UART2_SR;
+
+volatile uint32_t t2_millis = 0; // set by the test
+volatile uint16_t t2_epoch  = 0; // number of wraps of t2_millis, set by the test
+
+uint32_t millis(void)        { return t2_millis; }
+uint32_t micros(void)        { return t2_millis * 1000; }
+uint32_t uptime_sec(void)    { return t2_millis / 1000; }
+void     time_now(mono_time *t)  { t->epoch = t2_epoch; t->msec = t2_millis; }
+uint16_t tmr2_val(void)      { return ((uint16_t)TIM2_CNTRH << 8) | TIM2_CNTRL; }
+void     delay_msec(uint16_t ms) { t2_millis += ms; }
+
+#ifndef STUB_NO_UART // uart.c is not linked with the test
+void     xputs(const char *s) { fputs(s, stdout); }
+#endif
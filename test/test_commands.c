@@ -0,0 +1,211 @@
+/*==================================================================
+  File Name    : test_commands.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host tests for the UART commands of comms.c, with uart.c
+            and scheduler.c. Every command line is received by the RX
+            interrupt and executed one row at a time, the same way as
+            rs232_task() does it. Checked are:
+            - a row of a reply is at most REPLY_ROW_MAX bytes, also with
+              the longest values, so xputs() never waits (tx_wait_ms).
+            - the replies are complete and the line buffer is given back.
+            - the errors and the commands without a number, as before
+              the command table: 's' is 's0', 'e' is 'e0', 'p' is 'p0'.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <string.h>
+#include <iostm8s105c6.h>
+#include "host.h"
+#include "uart.h"
+#include "comms.h"
+#include "scheduler.h"
+#include "w3230_lib.h"
+
+extern volatile uint32_t t2_millis;
+extern volatile uint16_t t2_epoch;
+extern uint16_t    tx_wait_ms;
+extern task_struct task_list[];
+extern isr_struct  isr_list[];
+extern bool        uart_echo;
+extern uint16_t    eep[];
+void UART_RX_IRQHandler(void);
+void UART_TX_IRQHandler(void);
+
+char     out[4000];  // everything sent by the TX interrupt for one line
+uint16_t out_len;
+uint16_t max_row;    // longest row of all replies
+
+void dummy_task(void) { }
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Send everything in the transmit buffer with the TX interrupt
+  ---------------------------------------------------------------------------*/
+void tx_drain(void)
+{
+    while (UART2_CR2_TIEN)
+    {
+        UART_TX_IRQHandler();
+        if (UART2_CR2_TIEN && (out_len < sizeof(out) - 1)) out[out_len++] = UART2_DR;
+    } // while
+    out[out_len] = '\0';
+} // tx_drain()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Receive a command line and execute it like rs232_task()
+  Variables: line: the command line, without new-line
+  Returns  : the result of the last row [NO_ERR, ERR_CMD, ERR_NUM]
+  ---------------------------------------------------------------------------*/
+uint8_t run_line(const char *line)
+{
+    uint8_t  row = 0, rval;
+    uint16_t n;
+
+    while (*line)
+    {
+        UART2_DR = *line++;
+        UART_RX_IRQHandler();
+    } // while
+    UART2_DR = '\n';
+    UART_RX_IRQHandler();
+    CHECK(uart_line_ready());
+    out_len = 0;
+    do
+    {   // the transmit buffer is empty here, rs232_task() only needs REPLY_ROW_MAX
+        CHECK(uart_write_room() >= REPLY_ROW_MAX);
+        rval = rs232_command_handler(row++);
+        n    = TX_BUF_SIZE - uart_write_room();
+        CHECK(n <= REPLY_ROW_MAX);
+        if (n > max_row) max_row = n;
+        tx_drain();
+    } while ((rval == CMD_MORE) && (row < 100));
+    CHECK(rval != CMD_MORE);
+    CHECK(!uart_line_ready());
+    return rval;
+} // run_line()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Count the lines in the output
+  ---------------------------------------------------------------------------*/
+uint16_t out_lines(void)
+{
+    uint16_t i, n = 0;
+
+    for (i = 0; i < out_len; i++) if (out[i] == '\n') n++;
+    return n;
+} // out_lines()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The tasks of main(), with the longest values for every column
+  ---------------------------------------------------------------------------*/
+void add_tasks(void)
+{
+    const uint16_t period[7] = {500, 100, 100, 1000, 60000, 1000, 1000};
+    task_struct    *p;
+    uint8_t        i, j;
+
+    scheduler_init();
+    for (i = 0; i < 7; i++)
+    {
+        add_task(dummy_task, "RS2", 0, period[i]);
+        p = &task_list[i];
+        p->Phase    = 59999;
+        p->Duration = p->Duration_Min = p->Duration_Max = 65535;
+        p->Runs     = 4294967295UL;
+        p->Drift    = -2147483647L;
+        p->Missed   = p->Overruns = p->Jitter_Max = 65535;
+        for (j = 0; j < PROF_BINS; j++) p->Hist[j] = 65535;
+    } // for
+    for (i = 0; i < NR_ISRS; i++)
+    {
+        isr_list[i].Calls = 3999999L;
+        isr_list[i].Min   = isr_list[i].Max = 65535;
+        isr_list[i].Sum   = 4000000000UL;
+    } // for
+} // add_tasks()
+
+int main(void)
+{
+    char    s[10];
+    uint8_t i;
+
+    uart_init();
+    add_tasks();
+    t2_millis = 3600000UL; // statistics of one hour
+    for (i = 0; i < 255; i++) eep[i] = 65535;
+
+    CHECK(run_line("s2") == NO_ERR);          // Phases, header and 7 tasks
+    CHECK(out_lines() == 1 + 2 + 7);
+    CHECK(run_line("s5") == NO_ERR);
+    CHECK(out_lines() == 1 + 1 + 7);
+    CHECK(run_line("s6") == NO_ERR);
+    CHECK(out_lines() == 1 + 1 + 7);
+    CHECK(run_line("s7") == NO_ERR);
+    CHECK(out_lines() == 1 + 1 + NR_ISRS);
+    for (i = 0; i < NR_ISRS; i++) isr_list[i].Sum = 4000000000UL;
+    t2_millis += 500000000UL;                 // 5.8 days, msec * 10 does not fit in 32 bits
+    CHECK(run_line("s7") == NO_ERR);
+    CHECK(strstr(out, ",0.8\r\n") != NULL); // load of 4000 sec. in 500000 sec.
+    for (i = 0; i < NR_ISRS; i++) isr_list[i].Sum = 4000000000UL;
+    t2_epoch++;                               // 49.7 days later, millis() is the same
+    CHECK(run_line("s7") == NO_ERR);
+    CHECK(strstr(out, ",0.0\r\n") != NULL); // load of 4000 sec. in 4294967 sec.
+    CHECK(run_line("s1") == NO_ERR);          // every address answers
+    CHECK(out_lines() == 1 + 1);
+    CHECK(strstr(out, "0xfe \r\n") != NULL);
+    CHECK(run_line("h") == NO_ERR);
+    CHECK(out_lines() > 20);
+    for (i = 0; i <= NO_OF_PROFILES; i++)
+    {   // one line with all values
+        sprintf(s, "p%d", i);
+        CHECK(run_line(s) == NO_ERR);
+        CHECK(out_lines() == 1 + 1);
+    } // for
+    CHECK(strstr(out, "\r\np6 65535,") != NULL);
+    CHECK(strstr(out, ",65535\r\n") != NULL);
+    CHECK(run_line("s0") == NO_ERR);
+    CHECK(run_line("s3") == NO_ERR);
+    CHECK(run_line("s4") == NO_ERR);
+    CHECK(run_line("s8") == NO_ERR);
+    CHECK(run_line("s9") == NO_ERR);
+    CHECK(run_line("sp=120") == NO_ERR);
+    CHECK(!strcmp(out, "sp=120\r\nSP=12.0\r\n"));
+    CHECK(run_line("pid") == NO_ERR);
+    CHECK(run_line("te 6") == NO_ERR);
+    CHECK(run_line("td 7") == ERR_NUM);
+    CHECK(run_line("xyz") == ERR_CMD);
+    CHECK(run_line("rb") == ERR_NUM);         // not enough items
+    CHECK(run_line("s") == NO_ERR);           // 's' is 's0'
+    CHECK(!strcmp(out, "s\r\nW3230-stm8s105c6 host\r\n"));
+    CHECK(run_line("s10") == ERR_NUM);
+    CHECK(run_line("s 4") == NO_ERR);         // 's4'
+    CHECK(!strncmp(out, "s 4\r\nCPU load:", 14));
+    CHECK(run_line("v5=300") == NO_ERR);
+    CHECK(eep[5] == 300);
+    CHECK(run_line("v5") == NO_ERR);          // ignored
+    CHECK(eep[5] == 300);
+    CHECK(run_line("p") == NO_ERR);           // 'p' is 'p0'
+    CHECK(!strncmp(out, "p\r\np0 ", 6));
+    CHECK(run_line("e") == NO_ERR);           // 'e' is 'e0'
+    CHECK(!uart_echo);
+    CHECK(run_line("e1") == NO_ERR);
+    CHECK(uart_echo);
+    CHECK(run_line("e0") == NO_ERR);
+    CHECK(run_line("s0") == NO_ERR);          // no echo
+    CHECK(!uart_echo && !strcmp(out, "W3230-stm8s105c6 host\r\n"));
+    CHECK(tx_wait_ms == 0);                   // xputs() never waited
+    printf("longest row: %u bytes\n", max_row);
+    return CHECK_DONE("test_commands");
+} // main()
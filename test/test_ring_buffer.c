@@ -0,0 +1,167 @@
+/*==================================================================
+  File Name    : test_ring_buffer.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host unit tests for the ring-buffers of ring_buffer.h:
+            init/put/get/full/empty, wrap-around of the free-running
+            16-bit indices, bulk write/read across the end of the
+            buffer, peek/commit and a size above 255 elements.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include "host.h"
+#include "ring_buffer.h"
+
+RING_BUFFER_DEF(rb8,  uint8_t,  16)
+RING_BUFFER_DEF(rb16, uint16_t, 512)
+
+/*-----------------------------------------------------------------------------
+  Purpose  : init, put, get, count, free, full and empty
+  ---------------------------------------------------------------------------*/
+void test_put_get(void)
+{
+    struct rb8 r;
+    uint8_t    i;
+
+    rb8_init(&r);
+    CHECK(rb8_is_empty(&r));
+    CHECK(!rb8_is_full(&r));
+    CHECK(rb8_count(&r) == 0);
+    CHECK(rb8_free(&r) == 16);
+    for (i = 0; i < 16; i++) rb8_put(&r, i);
+    CHECK(rb8_is_full(&r)); // all 16 slots are used, no slot is wasted
+    CHECK(rb8_count(&r) == 16);
+    CHECK(rb8_free(&r) == 0);
+    for (i = 0; i < 16; i++) CHECK(rb8_get(&r) == i);
+    CHECK(rb8_is_empty(&r));
+} // test_put_get()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : head and tail wrap from 0xFFFF to 0x0000 while the buffer is used
+  ---------------------------------------------------------------------------*/
+void test_wrap(void)
+{
+    struct rb8 r;
+    uint16_t   i;
+
+    rb8_init(&r);
+    r.head = r.tail = 0xFFF8; // 8 elements before the indices wrap
+    for (i = 0; i < 12; i++) rb8_put(&r, (uint8_t)i);
+    CHECK(r.head == 0x0004);
+    CHECK(rb8_count(&r) == 12);
+    CHECK(rb8_free(&r)  == 4);
+    CHECK(!rb8_is_full(&r));
+    for (i = 0; i < 4; i++) rb8_put(&r, (uint8_t)(12 + i));
+    CHECK(rb8_is_full(&r));
+    for (i = 0; i < 16; i++) CHECK(rb8_get(&r) == i);
+    CHECK(rb8_is_empty(&r));
+    CHECK(r.tail == 0x0008);
+
+    for (i = 0; i < 40000; i++)
+    {   // run the indices around a few times, count stays 0 or 1
+        rb8_put(&r, (uint8_t)i);
+        CHECK(rb8_count(&r) == 1);
+        CHECK(rb8_get(&r) == (uint8_t)i);
+    } // for
+    CHECK(rb8_is_empty(&r));
+} // test_wrap()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : rb8_write()/rb8_read() across the end of buf[] and when full/empty
+  ---------------------------------------------------------------------------*/
+void test_bulk(void)
+{
+    struct rb8 r;
+    uint8_t    src[20], dst[20];
+    uint8_t    i;
+
+    for (i = 0; i < 20; i++) src[i] = 100 + i;
+    rb8_init(&r);
+    r.head = r.tail = 0xFFFB; // index 11 in buf[]
+    CHECK(rb8_write(&r, src, 10) == 10); // buf[11..15] + buf[0..4]
+    CHECK(rb8_count(&r) == 10);
+    CHECK(rb8_write(&r, &src[10], 10) == 6); // only 6 fit
+    CHECK(rb8_is_full(&r));
+    CHECK(rb8_write(&r, src, 1) == 0);
+    CHECK(rb8_read(&r, dst, 20) == 16);
+    for (i = 0; i < 16; i++) CHECK(dst[i] == src[i]);
+    CHECK(rb8_is_empty(&r));
+    CHECK(rb8_read(&r, dst, 1) == 0);
+    CHECK(rb8_write(&r, src, 0) == 0);
+} // test_bulk()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : peek() stops at the end of buf[], commit() removes the elements
+  ---------------------------------------------------------------------------*/
+void test_peek_commit(void)
+{
+    struct rb8       r;
+    volatile uint8_t *p;
+    uint16_t         n;
+    uint8_t          i;
+
+    rb8_init(&r);
+    p = rb8_peek(&r, &n);
+    CHECK(n == 0);
+    r.head = r.tail = 12;
+    for (i = 0; i < 7; i++) rb8_put(&r, i); // buf[12..15] + buf[0..2]
+    p = rb8_peek(&r, &n);
+    CHECK(n == 4); // up to the end of buf[]
+    CHECK(p == &r.buf[12]);
+    for (i = 0; i < 4; i++) CHECK(p[i] == i);
+    CHECK(rb8_count(&r) == 7); // peek() does not remove anything
+    rb8_commit(&r, n);
+    p = rb8_peek(&r, &n);
+    CHECK(n == 3);
+    CHECK(p == &r.buf[0]);
+    CHECK(p[0] == 4);
+    rb8_commit(&r, 1); // commit less than peeked
+    CHECK(rb8_count(&r) == 2);
+    CHECK(rb8_get(&r) == 5);
+    CHECK(rb8_get(&r) == 6);
+    CHECK(rb8_is_empty(&r));
+} // test_peek_commit()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : 16-bit elements and a size above 255
+  ---------------------------------------------------------------------------*/
+void test_large(void)
+{
+    struct rb16 r;
+    uint16_t    i;
+
+    rb16_init(&r);
+    r.head = r.tail = 0xFF00;
+    for (i = 0; i < 512; i++) rb16_put(&r, i * 3);
+    CHECK(rb16_is_full(&r));
+    CHECK(rb16_count(&r) == 512);
+    for (i = 0; i < 300; i++) CHECK(rb16_get(&r) == (uint16_t)(i * 3));
+    CHECK(rb16_free(&r) == 300);
+    for (i = 0; i < 300; i++) rb16_put(&r, 0x8000 + i);
+    CHECK(rb16_is_full(&r));
+    for (i = 300; i < 512; i++) CHECK(rb16_get(&r) == (uint16_t)(i * 3));
+    for (i = 0; i < 300; i++) CHECK(rb16_get(&r) == 0x8000 + i);
+    CHECK(rb16_is_empty(&r));
+} // test_large()
+
+int main(void)
+{
+    test_put_get();
+    test_wrap();
+    test_bulk();
+    test_peek_commit();
+    test_large();
+    return CHECK_DONE("test_ring_buffer");
+} // main()
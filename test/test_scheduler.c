@@ -0,0 +1,215 @@
+/*==================================================================
+  File Name    : test_scheduler.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host unit tests for scheduler.c. The Makefile builds this
+            with and without SCHED_ABSOLUTE:
+            - the delta-queue stays intact when a task that is still in
+              the queue is made ready by an event.
+            - only periodic releases are counted as missed or overrun.
+            - a coroutine is counted as one run, not per slice.
+            - scheduler_stagger() never releases a task earlier than one
+              period after its previous release, also when called again.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <string.h>
+#include "host.h"
+#include "scheduler.h"
+
+extern volatile uint32_t t2_millis;
+extern task_struct       task_list[];
+extern uint8_t           dq_head;
+extern uint8_t           max_tasks;
+extern uint8_t           cur_task;
+extern uint32_t          stagger_loops;
+
+uint16_t runs[MAX_TASKS];  // number of times every task has run
+uint32_t first[MAX_TASKS]; // time of the 1st run of every task
+uint32_t last[MAX_TASKS];  // time of the last run of every task
+uint32_t gap[MAX_TASKS];   // min. time between two runs of every task
+uint8_t  yield_ms;         // number of msec. that yield_task() keeps yielding
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Task that records when it runs, for every task handle
+  ---------------------------------------------------------------------------*/
+void rec_task(void)
+{
+    uint8_t i = cur_task;
+
+    if (runs[i] == 0)                   first[i] = t2_millis;
+    else if (t2_millis - last[i] < gap[i]) gap[i] = t2_millis - last[i];
+    last[i] = t2_millis;
+    runs[i]++;
+} // rec_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Task that stays ready (yields) for yield_ms calls
+  ---------------------------------------------------------------------------*/
+void yield_task(void)
+{
+    if (yield_ms)
+    {
+        yield_ms--;
+        task_yield();
+    } // if
+} // yield_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Clear the scheduler and the recorded runs
+  ---------------------------------------------------------------------------*/
+void reset(void)
+{
+    t2_millis = 0;
+    max_tasks = 0;
+    scheduler_init();
+    memset(runs, 0, sizeof(runs));
+    memset(gap, 0xFF, sizeof(gap));
+} // reset()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Check that the delta-queue is a list without loops that
+             contains every task once.
+  Variables: n: number of tasks
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void check_queue(uint8_t n)
+{
+    uint8_t i, len = 0;
+    uint8_t seen[MAX_TASKS] = {0};
+
+    for (i = dq_head; (i != NO_TASK) && (len <= n); i = task_list[i].Next)
+    {
+        CHECK(i < n);
+        if (i >= n) return;
+        CHECK(!seen[i]);
+        seen[i] = 1;
+        len++;
+    } // for
+    CHECK(len == n);
+} // check_queue()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Advance the time and run dispatch_tasks()
+  Variables: ms: number of msec.
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void run_msec(uint16_t ms)
+{
+    while (ms--)
+    {
+        t2_millis++;
+        dispatch_tasks();
+    } // while
+} // run_msec()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : A task that is still in the delta-queue is made ready by an event
+  ---------------------------------------------------------------------------*/
+void test_event(void)
+{
+    uint8_t h;
+
+    reset();
+    add_task(rec_task, "task0",  0, 100);
+    h = add_task(rec_task, "task1", 10, 100);
+    add_task(rec_task, "task2", 20, 100);
+    bind_task_event(h, EV_UART_LINE);
+    check_queue(3);
+
+    run_msec(50); // task1 is released by an event while it is in the delta-queue
+    event_post(EV_UART_LINE);
+    run_msec(1);
+    CHECK(runs[1] == 1);
+    check_queue(3);
+
+    run_msec(1000); // periodic releases
+    check_queue(3);
+    CHECK((runs[0] >= 9) && (runs[0] <= 11));
+    CHECK((runs[1] >= 9) && (runs[1] <= 12));
+    CHECK((runs[2] >= 9) && (runs[2] <= 11));
+
+    event_post(EV_UART_LINE); // and once more, after periodic releases
+    run_msec(1);
+    check_queue(3);
+} // test_event()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Missed releases are only counted for a task that is still ready
+             from its previous periodic release, not from an event.
+  ---------------------------------------------------------------------------*/
+void test_missed(void)
+{
+    uint8_t h;
+
+    reset();
+    h = add_task(yield_task, "yield", 5, 10);
+    bind_task_event(h, EV_UART_LINE);
+    run_msec(2);
+    yield_ms = 25;           // released by an event, ready during 3 periods
+    event_post(EV_UART_LINE);
+    run_msec(30);
+    CHECK(task_list[h].Runs     == 1);   // 26 slices of one run
+    CHECK(task_list[h].Missed   == 0);
+    CHECK(task_list[h].Overruns == 0);
+
+    yield_ms = 25;           // released by its period, ready during 3 periods
+    run_msec(40);
+#if SCHED_ABSOLUTE
+    CHECK(task_list[h].Missed >= 2);
+#else
+    CHECK(task_list[h].Missed == 0); // the period starts again when the task has finished
+#endif
+    CHECK(task_list[h].Overruns == 0);
+} // test_missed()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : The tasks of main(), staggered at power-up and again after 5 sec.
+  ---------------------------------------------------------------------------*/
+void test_stagger(void)
+{
+    const uint16_t period[7] = {500, 100, 100, 1000, 60000, 1000, 1000};
+    const uint16_t delay[7]  = {  0,  50,  80,  200,   300,  250,  400};
+    uint8_t        i;
+
+    reset();
+    for (i = 0; i < 7; i++) add_task(rec_task, "rec", delay[i], period[i]);
+    scheduler_stagger();
+    while (!scheduler_stagger_step()) ; // at power-up: at once
+    run_msec(5000);
+    scheduler_stagger(); // the 2nd call, with measured durations, in chunks
+    run_msec(65000);
+    for (i = 0; i < 7; i++)
+    {
+        CHECK(first[i] >= period[i]);        // not before one period after power-up
+        CHECK(first[i] <  2 * period[i] || i == 4);
+        CHECK((runs[i] < 2) || (gap[i] >= period[i])); // never released too early
+        CHECK(task_list[i].Phase < period[i]);
+    } // for
+    CHECK(first[0] < first[3]);              // ADC runs before CTL
+    CHECK(runs[4] == 1);                     // PRF only once in the 1st minute
+    CHECK((first[4] >= 60000) && (first[4] < 66000));
+    CHECK(runs[3] >= 65);                    // no releases lost by the 2nd call
+    CHECK(stagger_loops <= 6 * STAGGER_LOOPS); // 1st task has nothing to compare with
+    check_queue(7);
+} // test_stagger()
+
+int main(void)
+{
+    test_event();
+    test_missed();
+    test_stagger();
+    return CHECK_DONE("test_scheduler");
+} // main()
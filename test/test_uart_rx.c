@@ -0,0 +1,152 @@
+/*==================================================================
+  File Name    : test_uart_rx.c
+  Author       : Emile
+  ------------------------------------------------------------------
+  Purpose : Host stress test of the UART RX interrupt of uart.c. Lines
+            with random length and contents are fed back-to-back, one
+            byte per call of UART_RX_IRQHandler(). The command handler
+            takes and returns lines at random moments, also while the
+            interrupt keeps receiving. Checked are:
+            - every line is received complete or dropped complete.
+            - lines are lowercase, without CR and truncated to
+              UART_BUFLEN-1 characters.
+            - a line that is being handled is never overwritten.
+            - every received line posts EV_UART_LINE.
+            - rx_lost is the number of characters of the dropped lines.
+  ------------------------------------------------------------------
+  This is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This file is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this file. If not, see <http://www.gnu.org/licenses/>.
+  ==================================================================
+*/
+#include <string.h>
+#include <iostm8s105c6.h>
+#include "host.h"
+#include "uart.h"
+#include "scheduler.h"
+
+#define LINES   (100000L) /* number of lines to send */
+#define MAX_LEN (60)      /* max. length of a line, longer than UART_BUFLEN */
+
+extern volatile uint16_t rx_lost;
+extern volatile uint8_t ev_pending;
+void UART_RX_IRQHandler(void);
+
+// Lines that are received according to the model, not yet handled
+char     exp_line[RX_LINES][UART_BUFLEN];
+uint8_t  exp_in = 0, exp_out = 0;
+uint16_t exp_lost = 0;   // characters lost according to the model
+uint32_t rng = 12345;    // state of the random generator
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Random number generator (LCG), the same numbers on every PC
+  Variables: n: range
+  Returns  : random number [0..n-1]
+  ---------------------------------------------------------------------------*/
+uint16_t rnd(uint16_t n)
+{
+    rng = rng * 1103515245UL + 12345;
+    return (uint16_t)((rng >> 16) % n);
+} // rnd()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Receive one byte: the RX interrupt
+  ---------------------------------------------------------------------------*/
+void rx_byte(uint8_t ch)
+{
+    UART2_DR = ch;
+    UART_RX_IRQHandler();
+} // rx_byte()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : Handle lines the same way as rs232_task(), at random moments.
+             A line is taken, then more bytes may be received before it is
+             checked and given back.
+  ---------------------------------------------------------------------------*/
+void handler_step(void)
+{
+    static char *p = NULL; // line taken with uart_get_line()
+
+    if (p)
+    {   // check the line after the interrupt has received more bytes
+        CHECK(exp_in != exp_out);
+        CHECK(!strcmp(p, exp_line[exp_out & (RX_LINES-1)]));
+        exp_out++;
+        uart_line_done();
+        p = NULL;
+    } // if
+    else if (uart_line_ready())
+    {
+        p = uart_get_line();
+        CHECK(p != NULL);
+    } // else if
+    else CHECK(uart_get_line() == NULL);
+} // handler_step()
+
+int main(void)
+{
+    const char chars[] = "SP=120 pid=-1 Rb 01Ab WW 0123 ab23 s7 E0 v12=300";
+    char       line[MAX_LEN + 2];
+    uint32_t   i;
+    uint16_t   len, j, k, busy;
+    bool       drop;
+    uint32_t   drops = 0; // number of dropped lines
+    char       *e;
+
+    uart_init();
+    for (i = 0; i < LINES; i++)
+    {
+        len = rnd(MAX_LEN + 1);
+        for (j = 0; j < len; j++) line[j] = chars[rnd(sizeof(chars) - 1)];
+        if (rnd(2)) line[len++] = '\r';
+        line[len++] = '\n';
+        busy = rnd(4) ? rnd(40) : rnd(400); // handler is sometimes slow
+        // model: a line is dropped when no line buffer is free at its 1st byte
+        drop = ((uint8_t)(exp_in - exp_out) >= RX_LINES);
+        if (drop)
+        {
+            exp_lost += len;
+            drops++;
+        } // if
+        else
+        {   // lowercase, without CR and new-line, truncated
+            e = exp_line[exp_in & (RX_LINES-1)];
+            for (j = k = 0; (j < len) && (k < UART_BUFLEN-1); j++)
+            {
+                if ((line[j] >= 'A') && (line[j] <= 'Z')) e[k++] = line[j] + 'a' - 'A';
+                else if ((line[j] != '\r') && (line[j] != '\n')) e[k++] = line[j];
+            } // for
+            e[k] = '\0';
+        } // else
+        for (j = 0; j < len; j++)
+        {   // back-to-back bytes, the handler runs in between
+            rx_byte(line[j]);
+            if (busy-- == 0)
+            {
+                handler_step();
+                busy = rnd(4) ? rnd(40) : rnd(400);
+            } // if
+        } // for
+        if (!drop)
+        {   // a received line wakes up the command handler
+            CHECK(ev_pending & EV_UART_LINE);
+            ev_pending = 0;
+            exp_in++;
+        } // if
+        CHECK(rx_lost == exp_lost);
+    } // for
+    for (j = 0; j <= 2 * RX_LINES; j++) handler_step(); // handle the remaining lines
+    CHECK(exp_in == exp_out);
+    CHECK(!uart_line_ready());
+    printf("%ld lines, %lu dropped\n", LINES, (unsigned long)drops);
+    return CHECK_DONE("test_uart_rx");
+} // main()
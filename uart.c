@@ -27,15 +27,27 @@
 #include "uart.h"
 #include "ring_buffer.h"
 #include "delay.h"
+#include "scheduler.h"
 
 // buffers for use with the ring buffer (belong to the USART)
 bool     ovf_buf_in; // true = input buffer overflow
 uint16_t isr_cnt = 0;
 
-struct ring_buffer ring_buffer_out;
-struct ring_buffer ring_buffer_in;
-uint8_t            out_buffer[TX_BUF_SIZE];
-uint8_t            in_buffer[RX_BUF_SIZE];
+RING_BUFFER_DEF(uart_tx, uint8_t, TX_BUF_SIZE) // producer: uart_write_buf(), consumer: TX interrupt
+struct uart_tx ring_buffer_out;
+
+// Received lines, filled by the RX interrupt. rx_in and rx_out are free-running
+// line counters: rx_in - rx_out is the number of complete lines.
+char             rx_line[RX_LINES][UART_BUFLEN];
+uint8_t          rx_len  = 0;     // Number of characters in the line being received
+volatile uint8_t rx_in   = 0;     // Number of lines received, only changed by RX interrupt
+volatile uint8_t rx_out  = 0;     // Number of lines done, only changed by uart_line_done()
+bool             rx_skip = false; // true = drop characters until the next new-line
+volatile uint16_t rx_lost = 0;    // Number of characters lost, no free line buffer
+
+uint16_t tx_drop_new = 0; // Number of bytes dropped with TX_DROP_NEW
+uint16_t tx_drop_old = 0; // Number of bytes dropped with TX_DROP_OLD
+uint16_t tx_wait_ms  = 0; // Number of msec. waited with TX_BLOCK
 
 uint8_t ch;       // debug
 uint8_t uart2_sr; // debug
@@ -52,14 +64,17 @@ uint8_t uart2_sr; // debug
 #pragma vector=UART2_T_TXE_vector
 __interrupt void UART_TX_IRQHandler(void)
 {
-    if (!ring_buffer_is_empty(&ring_buffer_out))
+    ISR_ENTER(); // time-measurement interrupt routine
+    
+    if (!uart_tx_is_empty(&ring_buffer_out))
     {   // if there is data in the ring buffer, fetch it and send it
-        UART2_DR = ring_buffer_get(&ring_buffer_out);
+        UART2_DR = uart_tx_get(&ring_buffer_out);
     } // if
     else
     {   // no more data to send, turn off interrupt
         UART2_CR2_TIEN = 0;
     } // else
+    ISR_EXIT(ISR_UART_TX);
 } /* UART_TX_IRQHandler() */
 
 //-----------------------------------------------------------------------------
@@ -70,24 +85,43 @@ __interrupt void UART_TX_IRQHandler(void)
 // RDR shift register has been transferred to the UART2_DR register. An interrupt 
 // is generated if RIEN=1 in the UART_CR2 register. It is cleared by a read to 
 // the UART2_DR register. It can also be cleared by writing 0.
+// The characters are assembled into lines (lowercase, without CR), one of
+// RX_LINES line buffers is filled while the other is executed. A complete 
+// line is posted as event EV_UART_LINE. When no line buffer is free, the 
+// line is dropped.
 //-----------------------------------------------------------------------------
 #pragma vector=UART2_R_RXNE_vector
 __interrupt void UART_RX_IRQHandler(void)
 {
-    volatile uint8_t ch;
+    uint8_t ch;
+    char    *p;
+    ISR_ENTER(); // time-measurement interrupt routine
     
-    if (!ring_buffer_is_full(&ring_buffer_in))
-    {
-        ring_buffer_put(&ring_buffer_in, UART2_DR);
-        ovf_buf_in = false;
-    } // if
-    else
-    {
-        uart2_sr   = UART2_SR; // Clear IDLE and Overrun errors
-        ch         = UART2_DR; // clear RXNE flag
+    uart2_sr = UART2_SR; // Clear IDLE and Overrun errors
+    ch       = UART2_DR; // clear RXNE flag
+    if (rx_skip || ((uint8_t)(rx_in - rx_out) >= RX_LINES))
+    {   // no free line buffer: drop the rest of this line
+        rx_skip    = (ch != '\n');
+        rx_len     = 0;
         ovf_buf_in = true;
-    } // else
+        rx_lost++;
+    } // if
+    else if (ch == '\n')
+    {   // line complete: hand it over to the command handler task
+        rx_line[rx_in & (RX_LINES-1)][rx_len] = '\0';
+        rx_len = 0;
+        rx_in++;
+        ovf_buf_in = false;
+        event_post(EV_UART_LINE); // wake up the command handler task
+    } // else if
+    else if ((ch != '\r') && (rx_len < UART_BUFLEN-1))
+    {   // add character as lowercase, a too long line is truncated
+        p = &rx_line[rx_in & (RX_LINES-1)][rx_len++];
+        if ((ch >= 'A') && (ch <= 'Z')) *p = ch + ('a' - 'A');
+        else                            *p = ch;
+    } // else if
     isr_cnt++;
+    ISR_EXIT(ISR_UART_RX);
 } /* UART_RX_IRQHandler() */
 
 /*------------------------------------------------------------------
@@ -114,8 +148,8 @@ void uart_init(void)
     UART2_PSCR = 0;
 
     // initialize the in and out buffer for the UART
-    ring_buffer_out = ring_buffer_init(out_buffer, TX_BUF_SIZE);
-    ring_buffer_in  = ring_buffer_init(in_buffer , RX_BUF_SIZE);
+    uart_tx_init(&ring_buffer_out);
+    rx_in = rx_out = rx_len = 0;
 
     UART2_CR1_M    = 0;     //  8 Data bits.
     UART2_CR1_PCEN = 0;     //  Disable parity.
@@ -140,6 +174,136 @@ void uart_init(void)
     UART2_CR3_CKEN = 0; // set to 0 or receive will not work!!
 } // uart_init()
 
+/*------------------------------------------------------------------
+  Purpose  : This function copies as many bytes as fit into the
+             transmit buffer and does not wait.
+             No interrupts are disabled: only the uart_write functions 
+             write to ring_buffer_out and only the TX interrupt reads 
+             from it. Setting TIEN after the put cannot be lost: if the
+             TX interrupt just cleared TIEN, it did so before the put.
+  Variables: buf: the bytes to send to the uart.
+             len: the number of bytes in buf.
+  Returns  : the number of bytes accepted [0..len]
+  ------------------------------------------------------------------*/
+uint16_t uart_write_buf(const uint8_t *buf, uint16_t len)
+{
+    uint16_t n = uart_tx_write(&ring_buffer_out, buf, len);
+
+    if (n) UART2_CR2_TIEN = 1; // enable data ready interrupt (single bit-set instruction)
+    return n;
+} // uart_write_buf()
+
+/*------------------------------------------------------------------
+  Purpose  : This function returns the free space in the transmit
+             buffer. rs232_task() waits (yields) until a complete row of
+             a reply fits, so that xputs() never has to wait.
+  Variables: -
+  Returns  : the number of bytes that fit in the transmit buffer
+  ------------------------------------------------------------------*/
+uint16_t uart_write_room(void)
+{
+    return uart_tx_free(&ring_buffer_out);
+} // uart_write_room()
+
+/*------------------------------------------------------------------
+  Purpose  : This function writes a number of bytes to the uart. It
+             waits until all bytes are in the transmit buffer.
+  Variables: buf: the bytes to send to the uart.
+             len: the number of bytes in buf.
+  Returns  : -
+  ------------------------------------------------------------------*/
+void uart_write_wait(const uint8_t *buf, uint16_t len)
+{
+    uint16_t n;
+    
+    while (len)
+    {
+        n    = uart_write_buf(buf, len);
+        buf += n;
+        len -= n;
+        if (len) 
+        {   // wait for the TX interrupt
+            delay_msec(1); 
+            tx_wait_ms++;
+        } // if
+    } // while
+} // uart_write_wait()
+
+/*------------------------------------------------------------------
+  Purpose  : This function writes a number of bytes to the uart. When
+             the transmit buffer is full, the policy decides:
+             - TX_BLOCK   : wait until all bytes are in the buffer.
+             - TX_DROP_NEW: the bytes that do not fit are dropped.
+             - TX_DROP_OLD: the oldest bytes in the buffer are dropped
+               to make room. Only for this, the TX interrupt is masked
+               (TIEN) while read_offset is changed.
+             Control tasks should never use TX_BLOCK.
+  Variables: buf   : the bytes to send to the uart.
+             len   : the number of bytes in buf.
+             policy: TX_BLOCK, TX_DROP_NEW or TX_DROP_OLD
+  Returns  : -
+  ------------------------------------------------------------------*/
+void uart_send(const uint8_t *buf, uint16_t len, uint8_t policy)
+{
+    uint16_t n = uart_write_buf(buf, len);
+    
+    buf += n;
+    len -= n;
+    if (!len) return; // everything fits
+    switch (policy)
+    {
+        case TX_DROP_NEW: 
+             tx_drop_new += len;
+             break;
+        case TX_DROP_OLD:
+             if (len > TX_BUF_SIZE)
+             {   // more than the buffer can hold: only send the last part
+                 n            = len - TX_BUF_SIZE;
+                 buf         += n;
+                 len         -= n;
+                 tx_drop_old += n;
+             } // if
+             UART2_CR2_TIEN = 0; // TX interrupt may not read ring_buffer_out now
+             n = uart_tx_free(&ring_buffer_out);
+             if (n < len)
+             {   // drop oldest bytes
+                 uart_tx_commit(&ring_buffer_out, len - n);
+                 tx_drop_old += len - n;
+             } // if
+             uart_tx_write(&ring_buffer_out, buf, len);
+             UART2_CR2_TIEN = 1; // enable data ready interrupt again
+             break;
+        default: // TX_BLOCK
+             uart_write_wait(buf, len);
+             break;
+    } // switch
+} // uart_send()
+
+/*------------------------------------------------------------------
+  Purpose  : This function prints the number of bytes dropped and the 
+             time waited because the transmit buffer was full and the
+             number of received characters lost because no line buffer
+             was free, since the previous call. Used by UART command s9.
+  Variables: -
+  Returns  : -
+  ------------------------------------------------------------------*/
+void uart_print_stats(void)
+{
+    char     s[50];
+    uint16_t lost;
+    
+    sprintf(s,"TX drop-new:%u, drop-old:%u, wait:%u ms\n",
+              tx_drop_new, tx_drop_old, tx_wait_ms);
+    tx_drop_new = tx_drop_old = tx_wait_ms = 0;
+    xputs(s);
+    UART2_CR2_RIEN = 0; // rx_lost is incremented by the RX interrupt
+    lost    = rx_lost;
+    rx_lost = 0;
+    UART2_CR2_RIEN = 1; // a received byte is handled now, RXNE stays set
+    sprintf(s,"RX lost:%u\n", lost);
+    xputs(s);
+} // uart_print_stats()
+
 /*------------------------------------------------------------------
   Purpose  : This function writes one data-byte to the uart.	
   Variables: data: the byte to send to the uart.
@@ -147,52 +311,80 @@ void uart_init(void)
   ------------------------------------------------------------------*/
 void uart_write(uint8_t data)
 {
-    while (ring_buffer_is_full(&ring_buffer_out)) delay_msec(1);
-    __disable_interrupt(); // Disable interrupts to get exclusive access to ring_buffer_out
-    if (ring_buffer_is_empty(&ring_buffer_out))
-    {
-        UART2_CR2_TIEN = 1; // First data in buffer, enable data ready interrupt
-    } // if
-    ring_buffer_put(&ring_buffer_out, data); // Put data in buffer
-    __enable_interrupt();                    // Re-enable interrupts
+    uart_write_wait(&data, 1);
 } // uart_write()
 
 /*------------------------------------------------------------------
-  Purpose  : This function reads one data-byte from the uart.	
+  Purpose  : This function returns the oldest line received by the uart.
+             The line stays valid until uart_line_done() is called.
   Variables: -
-  Returns  : the data-byte read from the uart
+  Returns  : the line (lowercase, without new-line) or NULL if no 
+             line was received
   ------------------------------------------------------------------*/
-uint8_t uart_read(void)
+char *uart_get_line(void)
 {
-    return ring_buffer_get(&ring_buffer_in);
-} // uart_read()
+    if (rx_in == rx_out) return NULL;
+    return rx_line[rx_out & (RX_LINES-1)];
+} // uart_get_line()
 
 /*------------------------------------------------------------------
-  Purpose  : This function checks if a character is present in the
-             receive buffer.
+  Purpose  : This function gives the line from uart_get_line() back to
+             the RX interrupt, which can then fill it again.
   Variables: -
-  Returns  : 1 if a character is received, 0 otherwise
+  Returns  : -
+  ------------------------------------------------------------------*/
+void uart_line_done(void)
+{
+    rx_out++;
+} // uart_line_done()
+
+/*------------------------------------------------------------------
+  Purpose  : This function checks if a complete line is received.
+  Variables: -
+  Returns  : true if a line is received, false otherwise
   ------------------------------------------------------------------*/
-bool uart_kbhit(void) /* returns true if character in receive buffer */
+bool uart_line_ready(void)
 {
-    return !ring_buffer_is_empty(&ring_buffer_in);
-} // uart_kbhit()
+    return rx_in != rx_out;
+} // uart_line_ready()
 
 /*------------------------------------------------------------------
-  Purpose  : This function writes a string to serial port 0, using
-             the xputc() routine.
+  Purpose  : This function writes a string to serial port 0. Every
+             line is copied into the transmit buffer in one go, a 
+             new-line is sent as CR + LF.
   Variables:
-         s : The string to write to serial port 0
-  Returns  : the number of characters written
+         s     : The string to write to serial port 0
+         policy: TX_BLOCK, TX_DROP_NEW or TX_DROP_OLD, see uart_send()
+  Returns  : -
   ------------------------------------------------------------------*/
-void xputs(char *s)
+void xputs_policy(const char *s, uint8_t policy)
 {
-    char *ch = s;
+    const char *ch;
 
-    while (*ch) 
+    while (*s) 
     {
-        if (*ch == '\n') uart_write('\r'); // add CR
-        uart_write(*ch++); // Grab the next character
+        for (ch = s; *ch && (*ch != '\n'); ch++) ; // find end of line
+        uart_send((const uint8_t *)s, ch - s, policy);
+        if (*ch == '\n') 
+        {   // add CR
+            uart_send((const uint8_t *)"\r\n", 2, policy);
+            ch++;
+        } // if
+        s = ch;
     } // while
+} // xputs_policy()
+
+/*------------------------------------------------------------------
+  Purpose  : This function writes a string to serial port 0 and waits
+             until it is in the transmit buffer. Use it for replies to
+             UART commands, use xputs_policy() from control tasks. A reply
+             row of max. REPLY_ROW_MAX bytes never waits, see rs232_task().
+  Variables:
+         s : The string to write to serial port 0
+  Returns  : -
+  ------------------------------------------------------------------*/
+void xputs(const char *s)
+{
+    xputs_policy(s, TX_BLOCK);
 } // xputs()
 
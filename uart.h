@@ -30,13 +30,27 @@
 #define BAUDRATE      (57600L)
 #define UART_BUFLEN        (40)
 
-#define TX_BUF_SIZE (30)
-#define RX_BUF_SIZE (20)
+#define TX_BUF_SIZE   (128) /* power of 2, see RING_BUFFER_DEF() */
+#define REPLY_ROW_MAX (100) /* max. bytes (with CR) of one row of a reply, < TX_BUF_SIZE */
+#define RX_LINES      (2)   /* Number of line buffers for received lines, power of 2 */
+
+// What to do when the transmit buffer is full, see uart_send()
+#define TX_BLOCK       (0) /* wait until everything is in the transmit buffer */
+#define TX_DROP_NEW    (1) /* drop the bytes that do not fit */
+#define TX_DROP_OLD    (2) /* drop the oldest bytes from the transmit buffer */
+#define TX_LOG_POLICY  (TX_DROP_NEW) /* policy for logging from control tasks */
 
 void    uart_init(void);
 void    uart_write(uint8_t data);
-uint8_t uart_read(void);
-void    xputs(char *s);
-bool    uart_kbhit(void); /* returns true if character in receive buffer */
+uint16_t uart_write_buf(const uint8_t *buf, uint16_t len);
+void    uart_write_wait(const uint8_t *buf, uint16_t len);
+void    uart_send(const uint8_t *buf, uint16_t len, uint8_t policy);
+uint16_t uart_write_room(void);
+void    uart_print_stats(void);
+char    *uart_get_line(void);
+void    uart_line_done(void);
+bool    uart_line_ready(void);
+void    xputs(const char *s);
+void    xputs_policy(const char *s, uint8_t policy);
 
 #endif
\ No newline at end of file
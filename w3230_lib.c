@@ -25,6 +25,8 @@
 #include "w3230_lib.h"
 #include "pid.h"
 #include "uart.h"
+#include "scheduler.h"
+#include "ring_buffer.h"
 #include <stdio.h>
 
 // LED character lookup table (0-9)
@@ -60,10 +62,24 @@ bool     pwr_on        = true;  // True = power ON, False = power OFF
 bool     fahrenheit    = false; // false = Celsius, true = Fahrenheit
 uint8_t  menu_item     = 6;     // Current menu-item: [0..NO_OF_PROFILES]
 uint8_t  config_item   = 0;     // Current index within profile or parameter menu
-uint8_t  m_countdown   = 0;     // Timer used within menu_fsm()
+uint8_t  menu_tmr = NO_TIMER;   // Software timer used within menu_fsm()
 uint8_t  _buttons      = 0;     // Current and previous value of button states
 int16_t  config_value;          // Current value of menu-item
-int8_t   key_held_tmr;          // Timer for value change acceleration
+uint8_t  key_flags     = 0;     // KEY_EV_REPEAT / KEY_EV_ACC of current key event
+uint8_t  key_last      = 0;     // Key state of the last key event, bits 3..0
+bool     key_wake      = false; // true = key events only wake up the display, see key_event()
+
+// Key scanner, called from the TMR2 interrupt by key_scan()
+uint8_t  key_raw       = 0;     // Last sample of the keys
+uint8_t  key_state     = 0;     // Debounced state of the keys
+uint8_t  key_deb       = 0;     // Debounce counter in msec.
+uint16_t key_rpt;               // Auto-repeat counter in msec.
+uint8_t  key_nrep;              // Number of auto-repeats, for acceleration
+RING_BUFFER_DEF(key_ring, uint8_t, KEY_QUEUE_SIZE)
+struct key_ring key_queue;      // Key events from key_scan() to key_event()
+led_row  led_cache[2];          // Last rendered value of top and bottom row, see value_to_led()
+uint16_t led_renders   = 0;     // Number of rows rendered by value_to_led()
+uint16_t led_skipped   = 0;     // Number of rows not rendered, because nothing changed
 uint8_t  sensor2_selected = 0;  // DOWN button pressed < 3 sec. shows 2nd temperature / pid_output
 int16_t  setpoint;              // local copy of SP variable
 uint16_t curr_dur = 0;          // local counter for temperature duration
@@ -180,6 +196,10 @@ void val_to_bcd(int16_t *value, uint16_t digit, uint8_t *led, uint8_t lz)
              temperature or a non-temperature value.
              In case of a temperature, a decimal point is displayed (for 0.1).
              In case of a non-temperature value, only the value itself is shown.
+             The last rendered value, format and digits of every row are
+             cached: if the value and format did not change and the digits
+             were not overwritten by others (e.g. an alarm or menu text),
+             the row is not rendered again.
   Variables: value  : the value to display
              decimal: 0=display as integer, 1=display temperature as xxx.1
              row    : ROW_TOP = display on top row of 7-segment displays
@@ -191,6 +211,28 @@ void value_to_led(int16_t value, uint8_t decimal, uint8_t row)
     int16_t val = value; // copy of value
     int16_t val2;        // copy of val
     uint8_t *p10, *p1, *p01; // pointers to 7-segment display values
+    led_row *c = &led_cache[(row == ROW_TOP) ? 0 : 1];
+    
+    if (row == ROW_TOP)
+    {
+        p10  = &top_10;
+        p1   = &top_1;   
+        p01  = &top_01;
+    }
+    else
+    {   // row == ROW_BOT
+        p10  = &bot_10;
+        p1   = &bot_1;   
+        p01  = &bot_01;
+    } // else
+    if (c->valid && (c->value == value) && (c->decimal == decimal) &&
+        (c->seg10 == *p10) && (c->seg1 == *p1) && (c->seg01 == *p01))
+    {   // row already shows this value
+        led_skipped++;
+        return;
+    } // if
+    c->value   = value;
+    c->decimal = decimal;
     
     if (val < 0) 
     {   // Handle negative values
@@ -208,18 +250,6 @@ void value_to_led(int16_t value, uint8_t decimal, uint8_t row)
     } // else if
     val2 = val;
     
-    if (row == ROW_TOP)
-    {
-        p10  = &top_10;
-        p1   = &top_1;   
-        p01  = &top_01;
-    }
-    else
-    {   // row == ROW_BOT
-        p10  = &bot_10;
-        p1   = &bot_1;   
-        p01  = &bot_01;
-    } // else
 	// Convert value to BCD and set LED outputs
 	val_to_bcd(&val,  100, p10 ,0);
 	val_to_bcd(&val,   10, p1  ,(*p10  != LED_OFF));
@@ -239,8 +269,29 @@ void value_to_led(int16_t value, uint8_t decimal, uint8_t row)
         //else if (val2 < 1000) *p100 = LED_MIN;
         // else value >= 1000: prevented by divu10()
     } // if
+    c->seg10 = *p10; // digits of this value, to detect changes by others
+    c->seg1  = *p1;
+    c->seg01 = *p01;
+    c->valid = true;
+    led_renders++;
 } // value_to_led()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine prints the number of rows rendered and skipped by
+             value_to_led() since the previous call and clears the counters.
+             Used by UART command s8.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void print_render_stats(void)
+{
+    char s[40];
+    
+    sprintf(s,"Render: %u, skipped: %u\n", led_renders, led_skipped);
+    xputs(s);
+    led_renders = led_skipped = 0;
+} // print_render_stats()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This task updates the current running profile. A profile consists
              of several temperature-time pairs. When a time-out occurs, the
@@ -389,32 +440,135 @@ int16_t check_config_value(int16_t config_value, uint8_t eeadr)
         } else if (type == t_runmode)
         {
             t_max = NO_OF_PROFILES;
+        } else if (type == t_bright)
+        {   // display intensity, see mpx_set_duty()
+            t_min = 1;
+            t_max = MPX_DUTY_MAX;
         } // else if
     } // else
     return range(config_value, t_min, t_max);
 } // check_config_value()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This routine reads the values of the buttons and returns the
-             result. Routine should be called every 100 msec.
-             The result is returned in the global variable _buttons. 
+  Purpose  : This routine initialises the queue with key events.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void key_init(void)
+{
+    key_ring_init(&key_queue);
+} // key_init()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine puts a key event in the queue and wakes up the
+             task that calls menu_fsm(). When the queue is full, the event
+             is lost. Only called by key_scan().
+  Variables: ev: the key state in bits 3..0 and the KEY_EV_* flags
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void key_put(uint8_t ev)
+{
+    if (!key_ring_is_full(&key_queue)) key_ring_put(&key_queue, ev);
+    event_post(EV_BUTTON); // wake up key_task()
+} // key_put()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine scans the keys and should be called every msec. 
+             from the TMR2 interrupt. A key state is accepted when it is
+             stable for KEY_DEBOUNCE msec., every new key state is an event.
+             When a key is held for KEY_REPEAT_DELAY msec., a repeat event
+             is sent every KEY_REPEAT_RATE msec. After TMR_KEY_ACC repeats,
+             the repeat events also have the KEY_EV_ACC flag.
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
-void read_buttons(void)
+void key_scan(void)
+{
+    uint8_t k = (((PB_IDR & PB_KEYS) >> 4) ^ 0x0F) & 0x0F; // Invert buttons (0 = pressed)
+    uint8_t ev;
+
+    if (k != key_raw)
+    {   // keys changed, start debouncing again
+        key_raw = k;
+        key_deb = KEY_DEBOUNCE;
+    } else if (key_deb)
+    {   // keys not changed since last sample
+        if ((--key_deb == 0) && (k != key_state))
+        {   // new debounced key state: press or release event
+            key_state = k;
+            key_rpt   = KEY_REPEAT_DELAY;
+            key_nrep  = 0;
+            key_put(k);
+        } // if
+    } else if (key_state && (--key_rpt == 0))
+    {   // key is held: auto-repeat event
+        key_rpt = KEY_REPEAT_RATE;
+        ev      = k | KEY_EV_REPEAT;
+        if (key_nrep < TMR_KEY_ACC) key_nrep++;
+        else                        ev |= KEY_EV_ACC;
+        key_put(ev);
+    } // else if
+} // key_scan()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine checks if there is a key event in the queue.
+  Variables: -
+  Returns  : true = key event in the queue, false = queue is empty
+  ---------------------------------------------------------------------------*/
+bool key_pending(void)
+{
+    return !key_ring_is_empty(&key_queue);
+} // key_pending()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine gets the next key event from the queue and makes
+             _buttons from it (previous key state in bits 7..4 and new key 
+             state in bits 3..0), so that it can be used by menu_fsm().
+             When key_wake is set, the key press woke up the blanked display:
+             its events are removed until all keys are released, so that
+             menu_fsm() never sees them.
+  Variables: -
+  Returns  : true = key event in _buttons, false = no key event
+  ---------------------------------------------------------------------------*/
+bool key_event(void)
 {
-    uint8_t b;
+    uint8_t ev;
     
-    // Save registers that interferes with LED's and disable common-cathodes
-    _buttons <<= 4;            // make room for new values of buttons
-    b          = (PB_IDR & PB_KEYS) >> 4;   // KEYS in bits 3..0
-    b          = (b ^ 0x0F) & 0x0F;         // Invert buttons (0 = pressed)
-    _buttons  |= b;            // add buttons
-} // read_buttons()
+    while (!key_ring_is_empty(&key_queue))
+    {
+        ev = key_ring_get(&key_queue);
+        if (key_wake)
+        {   // not for menu_fsm(), key_last is not changed
+            if (!(ev & 0x0F)) key_wake = false; // all keys released
+        } // if
+        else
+        {
+            key_flags = ev & (KEY_EV_REPEAT | KEY_EV_ACC);
+            _buttons  = (key_last << 4) | (ev & 0x0F);
+            key_last  = ev & 0x0F;
+            return true;
+        } // else
+    } // while
+    return false;
+} // key_event()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine makes _buttons from the key state of the last key
+             event, without any change. Used when menu_fsm() is called for 
+             its time-outs only.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void key_held(void)
+{
+    key_flags = 0;
+    _buttons  = (key_last << 4) | key_last;
+} // key_held()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This routine is the Finite State Machine (FSM) that controls the
-             menu for the 7-segment displays and should be called every 100 msec.
+             menu for the 7-segment displays. It should be called for every
+             key event (see key_event()) and every 100 msec. (see key_held()).
              It used a couple of global variables.
   Variables: -
   Returns  : -
@@ -423,8 +577,6 @@ void menu_fsm(void)
 {
    uint8_t run_mode, adr, type, eeadr_sp;
    
-   if (m_countdown) m_countdown--; // countdown counter
-    
    switch (menustate)
    {
        //--------------------------------------------------------------------         
@@ -432,7 +584,7 @@ void menu_fsm(void)
             pwr_on = eeprom_read_config(EEADR_POWER_ON);
             if (BTN_PRESSED(BTN_PWR))
             {
-                m_countdown = TMR_POWERDOWN;
+                timer_start(menu_tmr,TMR_POWERDOWN,false);
                 menustate   = MENU_POWER_DOWN_WAIT;
             } else if (pwr_on && _buttons)
             {
@@ -441,7 +593,7 @@ void menu_fsm(void)
                     menustate = MENU_SHOW_VERSION;
                 } else if (BTN_PRESSED(BTN_DOWN))
                 {   // DOWN button pressed
-                    m_countdown = TMR_SHOW_PROFILE_ITEM;
+                    timer_start(menu_tmr,TMR_SHOW_PROFILE_ITEM,false);
                     menustate   = MENU_SHOW_STATE_DOWN;
                 } else if (BTN_RELEASED(BTN_SET))
                 {   // SET button pressed
@@ -451,7 +603,7 @@ void menu_fsm(void)
 	     break;
        //--------------------------------------------------------------------         
        case MENU_POWER_DOWN_WAIT:
-            if (m_countdown == 0)
+            if (!timer_running(menu_tmr))
             {
                 pwr_on = eeprom_read_config(EEADR_POWER_ON);
                 pwr_on = !pwr_on;
@@ -482,9 +634,9 @@ void menu_fsm(void)
 	    run_mode = eeprom_read_config(EEADR_MENU_ITEM(rn));
             top_10 = LED_r; top_1 = LED_u; top_01 = LED_n;
             prx_to_led(run_mode, LEDS_RUN_MODE);
-            if ((run_mode < THERMOSTAT_MODE) && (m_countdown == 0))
+            if ((run_mode < THERMOSTAT_MODE) && !timer_running(menu_tmr))
             {
-                m_countdown = TMR_SHOW_PROFILE_ITEM;
+                timer_start(menu_tmr,TMR_SHOW_PROFILE_ITEM,false);
                 menustate   = MENU_SHOW_STATE_DOWN_2;
             } // if
 	    if(!BTN_HELD(BTN_DOWN)) menustate = MENU_IDLE;
@@ -494,9 +646,9 @@ void menu_fsm(void)
 	    top_10  = LED_S; top_1 = LED_t; 
             top_01 = LED_OFF;
             value_to_led(eeprom_read_config(EEADR_MENU_ITEM(St)),LEDS_INT, ROW_BOT);
-            if (m_countdown == 0)
+            if (!timer_running(menu_tmr))
             {
-                m_countdown = TMR_SHOW_PROFILE_ITEM;
+                timer_start(menu_tmr,TMR_SHOW_PROFILE_ITEM,false);
                 menustate   = MENU_SHOW_STATE_DOWN_3;
 	    }
 	    if(!BTN_HELD(BTN_DOWN)) menustate = MENU_IDLE;
@@ -506,9 +658,9 @@ void menu_fsm(void)
             top_10 = LED_d; top_1 = LED_h; 
             top_01 = LED_OFF;
             value_to_led(eeprom_read_config(EEADR_MENU_ITEM(dh)),LEDS_INT,ROW_BOT);
-            if(m_countdown == 0)
+            if(!timer_running(menu_tmr))
             {   // Time-Out
-                m_countdown = TMR_SHOW_PROFILE_ITEM;
+                timer_start(menu_tmr,TMR_SHOW_PROFILE_ITEM,false);
                 menustate   = MENU_SHOW_STATE_DOWN;
             } // if
             if(!BTN_HELD(BTN_DOWN))
@@ -531,12 +683,12 @@ void menu_fsm(void)
                 bot_1  = LED_A;
                 bot_01 = LED_r;
             } // else
-            m_countdown = TMR_NO_KEY_TIMEOUT;
+            timer_start(menu_tmr,TMR_NO_KEY_TIMEOUT,false);
             menustate   = MENU_SET_MENU_ITEM;
             break; // MENU_SHOW_MENU_ITEM
        //--------------------------------------------------------------------         
        case MENU_SET_MENU_ITEM:
-            if(m_countdown == 0 || BTN_RELEASED(BTN_PWR))
+            if(!timer_running(menu_tmr) || BTN_RELEASED(BTN_PWR))
             {   // On Time-out of S-button released, go back
                 menustate = MENU_IDLE;
             } else if(BTN_RELEASED(BTN_UP))
@@ -575,13 +727,13 @@ void menu_fsm(void)
             adr          = MI_CI_TO_EEADR(menu_item, config_item);
             config_value = eeprom_read_config(adr);
             config_value = check_config_value(config_value, adr);
-            m_countdown  = TMR_NO_KEY_TIMEOUT;
+            timer_start(menu_tmr,TMR_NO_KEY_TIMEOUT,false);
             ret_state    = MENU_SET_CONFIG_ITEM;   // return state
             menustate    = MENU_SHOW_CONFIG_VALUE; // display config value
 	    break;
        //--------------------------------------------------------------------         
        case MENU_SET_CONFIG_ITEM:
-	    if (m_countdown == 0)
+	    if (!timer_running(menu_tmr))
             {   // Timeout, go back to idle state
                 menustate = MENU_IDLE;
 	    } else if(BTN_RELEASED(BTN_PWR))
@@ -638,7 +790,7 @@ void menu_fsm(void)
                 menustate = MENU_SHOW_CONFIG_VALUE; // display config value
             } else if(BTN_RELEASED(BTN_SET))
             {   // S-button is released again
-                m_countdown  = TMR_NO_KEY_TIMEOUT;
+                timer_start(menu_tmr,TMR_NO_KEY_TIMEOUT,false);
                 menustate    = MENU_SET_CONFIG_VALUE; // display config value
             } // else if
             adr          = MI_CI_TO_EEADR(menu_item, config_item);
@@ -663,31 +815,31 @@ void menu_fsm(void)
                     value_to_led(config_value,LEDS_INT, ROW_BOT);
                 } // else
             } // else
-            m_countdown  = TMR_NO_KEY_TIMEOUT;
+            timer_start(menu_tmr,TMR_NO_KEY_TIMEOUT,false);
             menustate    = ret_state; // return to indicated state
             break;
        //--------------------------------------------------------------------         
        case MENU_SET_CONFIG_VALUE:
             adr = MI_CI_TO_EEADR(menu_item, config_item);
-            if (m_countdown == 0)
+            if (!timer_running(menu_tmr))
             {
                 menustate = MENU_IDLE;
             } else if (BTN_RELEASED(BTN_PWR))
             {
                 menustate = MENU_SHOW_CONFIG_ITEM;
-            } else if(BTN_HELD_OR_RELEASED(BTN_UP)) 
+            } else if(BTN_PRESSED(BTN_UP) || BTN_REPEATED(BTN_UP)) 
             {
                 config_value++;
-                if ((config_value > 1000) || (--key_held_tmr < 0))
+                if ((config_value > 1000) || BTN_ACCELERATED)
                 {
                     config_value += 9;
                 } // if
                 /* Jump to exit code shared with BTN_DOWN case */
                 goto chk_cfg_acc_label;
-            } else if(BTN_HELD_OR_RELEASED(BTN_DOWN)) 
+            } else if(BTN_PRESSED(BTN_DOWN) || BTN_REPEATED(BTN_DOWN)) 
             {
                 config_value--;
-                if ((config_value > 1000) || (--key_held_tmr < 0))
+                if ((config_value > 1000) || BTN_ACCELERATED)
                 {
                     config_value -= 9;
                 } // if
@@ -718,10 +870,7 @@ void menu_fsm(void)
                 } // if
                 eeprom_write_config(adr, config_value);
                 menustate = MENU_SHOW_CONFIG_ITEM;
-            } else 
-            {   // reset timer to default value
-                key_held_tmr = TMR_KEY_ACC; 
-            } // else
+            } // else if
             break; // MENU_SET_CONFIG_VALUE
        //--------------------------------------------------------------------         
        default:
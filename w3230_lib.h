@@ -81,7 +81,8 @@ enum e_item_type
     t_runmode,
     t_duration,
     t_boolean,
-    t_parameter
+    t_parameter,
+    t_bright
 }; // e_item_type
 
 #define MENU_TYPE_IS_TEMPERATURE(x) 	((x) <= t_sp_alarm)
@@ -111,6 +112,8 @@ enum e_item_type
 // FHi  Higher-limit temperature for fan control      0.0 to 99.9 C
 // HPL  Heating Power Limit for SSR in Watts          0 to 9999 W
 // HPt  Power Rating for heating element in Watts     0 to 9999 W
+// dI   Display intensity (brightness)                1 to 8, 8 = full brightness
+// db   Display blanking when no key is pressed       0 = off, 1 = blank display after TMR_NO_KEY_TIMEOUT
 //-----------------------------------------------------------------------------
 #define MENU_DATA(_) \
 	_(SP, 	LED_S, 	LED_P, 	LED_OFF, t_temperature,	200)	        \
@@ -131,9 +134,11 @@ enum e_item_type
 	_(FHI, 	LED_F, 	LED_H, 	LED_I,   t_temperature,	350)	        \
 	_(HPL, 	LED_H, 	LED_P, 	LED_L,   t_parameter,	150)	        \
 	_(HPt, 	LED_H, 	LED_P, 	LED_t,   t_parameter,	500)	        \
+	_(dI, 	LED_d, 	LED_I, 	LED_OFF, t_bright,	8)		\
+	_(db, 	LED_d, 	LED_b, 	LED_OFF, t_boolean,	0)		\
 	_(rn, 	LED_r, 	LED_u, 	LED_n,   t_runmode,     NO_OF_PROFILES)
 
-#define MENU_SIZE (19) /* Number of parameters in MENU_DATA */
+#define MENU_SIZE (21) /* Number of parameters in MENU_DATA */
 
 //-----------------------------------------------------------------------------
 // The data needed for the controller, but not shown in the 'Set' menu. 
@@ -191,6 +196,16 @@ enum menu_enum
 #define BTN_HELD(btn)		  ((_buttons & (btn)) == (btn))
 #define BTN_RELEASED(btn)	  ((_buttons & (btn)) == ((btn) & 0xf0))
 #define BTN_HELD_OR_RELEASED(btn) ((_buttons & (btn) & 0xf0))
+#define BTN_REPEATED(btn)	  ((key_flags & KEY_EV_REPEAT) && BTN_HELD(btn))
+#define BTN_ACCELERATED		  (key_flags & KEY_EV_ACC)
+
+// Key scanner, key_scan() is called every msec. from the TMR2 interrupt
+#define KEY_QUEUE_SIZE    (8)   /* Number of key events in the queue, power of 2 */
+#define KEY_DEBOUNCE      (5)   /* msec. that a key must be stable */
+#define KEY_REPEAT_DELAY  (500) /* msec. before the first auto-repeat */
+#define KEY_REPEAT_RATE   (100) /* msec. between auto-repeats */
+#define KEY_EV_REPEAT     (0x10) /* key event flag: auto-repeat of a held key */
+#define KEY_EV_ACC        (0x20) /* key event flag: held longer than TMR_KEY_ACC repeats */
 
 // Defines for prx_led() function
 #define LEDS_RUN_MODE (0)
@@ -202,6 +217,17 @@ enum menu_enum
 #define ROW_TOP       (2)
 #define ROW_BOT       (3)
 
+// Last rendered value of a row of 7-segment displays, see value_to_led()
+typedef struct _led_row
+{
+    bool    valid;   // true = the values below are from a rendered value
+    int16_t value;   // the value that was rendered
+    uint8_t decimal; // LEDS_INT or LEDS_TEMP
+    uint8_t seg10;   // the resulting 7-segment digits
+    uint8_t seg1;
+    uint8_t seg01;
+} led_row;
+
 // Defines for led_control() function
 #define LED_BLUE       (0)
 #define LED_RED        (1)
@@ -220,11 +246,11 @@ enum menu_enum
 #define STD_ENV_COOL (5)
 #define STD_ENV_WARM (6)
 
-// Timers for state transition diagram. One-tick = 100 msec.
-#define TMR_POWERDOWN          (30)
-#define TMR_SHOW_PROFILE_ITEM  (15)
-#define TMR_NO_KEY_TIMEOUT    (150)
-#define TMR_KEY_ACC            (20)
+// Timers for state transition diagram in msec., used with timer_start()
+#define TMR_POWERDOWN        (3000)
+#define TMR_SHOW_PROFILE_ITEM (1500)
+#define TMR_NO_KEY_TIMEOUT  (15000)
+#define TMR_KEY_ACC            (20) /* #auto-repeats (KEY_REPEAT_RATE) before acceleration */
 
 /* Menu struct */
 struct s_menu 
@@ -262,10 +288,16 @@ uint16_t divu10(uint16_t n);
 void     prx_to_led(uint8_t run_mode, uint8_t is_menu);
 void     val_to_bcd(int16_t *value, uint16_t digit, uint8_t *led, uint8_t lz);
 void     value_to_led(int value, uint8_t decimal, uint8_t row); 
+void     print_render_stats(void);
 void     update_profile(void);
 int16_t  range(int16_t x, int16_t min, int16_t max);
 int16_t  check_config_value(int16_t config_value, uint8_t eeadr);
-void     read_buttons(void);
+void     key_init(void);
+void     key_put(uint8_t ev);
+void     key_scan(void);
+bool     key_pending(void);
+bool     key_event(void);
+void     key_held(void);
 void     menu_fsm(void);
 void     led_control(bool led, uint8_t mode);
 void     temperature_control(int16_t temp);
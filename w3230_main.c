@@ -25,6 +25,7 @@
 #include "w3230_main.h"
 #include "w3230_lib.h"
 #include "scheduler.h"
+#include "coroutine.h"
 #include "adc.h"
 #include "eep.h"
 #include "i2c_bb.h"
@@ -46,7 +47,13 @@ uint16_t  ad_ntc2 = (512L << FILTER_SHIFT);
 int16_t   temp_ntc1;         // The temperature in E-1 C from NTC probe 1
 int16_t   temp_ntc2;         // The temperature in E-1 C from NTC probe 2
 uint8_t   mpx_nr = 0;        // Used in multiplexer() function
-int16_t   pwr_on_tmr = 1000; // Needed for 7-segment display test
+mpx_digit mpx_img[2][6];      // Front and back buffer with port-bits for every digit
+volatile uint8_t mpx_front = 0; // Buffer to display, set by display_publish()
+uint8_t   mpx_buf = 0;       // Buffer that multiplexer() displays in the current frame
+volatile uint8_t mpx_duty = MPX_DUTY_MAX; // Duty-cycle of the display, 0 = blanked
+uint8_t   blank_tmr = NO_TIMER; // Software timer for display blanking (menu item db)
+uint8_t   lamp_tmr = NO_TIMER; // Software timer for 7-segment display test
+bool      pwr_on_old = false; // Previous value of pwr_on, for display test
 int16_t   temp1_ow_10;       // Temperature from DS18B20 in C * 10
 uint8_t   temp1_ow_err = 0;  // 1 = Read error from DS18B20
 uint8_t   fan_ctrl = 0;      // 1 = Use one-wire sensor for FAN control
@@ -58,6 +65,10 @@ uint16_t  hp_tot;            // Rated power for heating element
 // External variables, defined in other files
 extern uint8_t  top_10, top_1, top_01; // values of 10s, 1s and 0.1s
 extern uint8_t  bot_10, bot_1, bot_01; // values of 10s, 1s and 0.1s
+
+// Common-cathode masks for every digit of multiplexer()
+const uint8_t   mpx_pc_cc[6] = {(uint8_t)~CC1, (uint8_t)~CC2, (uint8_t)~CC3, 0xFF, 0xFF, 0xFF};
+const uint8_t   mpx_pe_cc[6] = {0xFF, 0xFF, 0xFF, (uint8_t)~CC4, (uint8_t)~CC5, (uint8_t)~CC6};
 extern bool     pwr_on;           // True = power ON, False = power OFF
 extern uint8_t  sensor2_selected; // DOWN button pressed < 3 sec. shows 2nd temperature / pid_output
 extern bool     menu_is_idle;     // No menus in STD active
@@ -67,107 +78,175 @@ extern uint16_t heating_delay;    // Initial heating delay
 extern int16_t  setpoint;         // local copy of SP variable
 extern uint8_t  ts;               // Parameter value for sample time [sec.]
 extern int16_t  pid_out;          // Output from PID controller in E-1 %
-extern uint32_t t2_millis;        // needed for delay_msec()
-extern uint8_t  rs232_inbuf[];
 extern uint8_t  std_tc;           // State for Temperature Control
+extern uint8_t  menu_tmr;         // Software timer used within menu_fsm()
+extern bool     key_wake;         // true = key events only wake up the display
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine converts the value of a 7-segment digit into the 
+             bits for the PG, PD and PE ports. Called by display_publish() 
+             only when the value of the digit has changed.
+  Variables: p  : pointer to the port-bits of the digit
+             seg: the 7-segment value of the digit (LED_* value)
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void mpx_build(mpx_digit *p, uint8_t seg)
+{
+    // PD7 PG1 PG0 PD4 PD3 PD2 PE0 PD0
+    //  D   E   F   G   dp  A   C   B 
+    p->pg  = (seg >> 5) & PG_SEG7; // 7-segment E+F
+    p->pd  = seg & PD_SEG7;        // 7-segments D,G,dp,A,B
+    p->pe  = (seg >> 1) & PE_SEG7; // 7-segment C
+    p->seg = seg;
+} // mpx_build()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine sets the duty-cycle of the 7-segment displays. 
+             Every digit is switched on at the start of its 1 msec. slot by
+             multiplexer() and switched off again by the TMR2 compare 
+             interrupt after duty * MPX_DUTY_US usec. The compare interrupt
+             is only enabled when a digit must be switched off early.
+  Variables: duty: 0 = display blanked, MPX_DUTY_MAX = full brightness
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void mpx_set_duty(uint8_t duty)
+{
+    uint16_t cmp;
+    
+    if (duty == mpx_duty) return; // nothing changed
+    if ((duty > 0) && (duty < MPX_DUTY_MAX))
+    {
+        cmp = duty * MPX_DUTY_US;
+        TIM2_CCR1H     = (uint8_t)(cmp >> 8); // MSB first, compare is disabled until LSB is written
+        TIM2_CCR1L     = (uint8_t)cmp;
+        TIM2_SR1_CC1IF = 0; // no interrupt from an old compare
+        TIM2_IER_CC1IE = 1; // enable compare interrupt
+    } // if
+    else TIM2_IER_CC1IE = 0; // blanked or full brightness, no compare interrupt needed
+    mpx_duty = duty;
+} // mpx_set_duty()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine publishes the display values top_10..bot_01 to the
+             multiplexer. The power-off and display-test overlays are added
+             here, the port-bits are made in the back buffer and then the
+             back buffer becomes the front buffer with a single write.
+             The multiplexer() only switches buffers at the start of a frame, 
+             so a frame never shows a mix of old and new values. If the 
+             previous publish is not displayed yet, this one is skipped: 
+             key_task() publishes again within 100 msec.
+             The duty-cycle follows menu item dI. With menu item db set, the
+             display is blanked when no key is pressed for TMR_NO_KEY_TIMEOUT
+             msec. while the menu is idle and there is no alarm.
+             Call after all display values are updated, not from an interrupt.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void display_publish(void)
+{
+    uint8_t    i;
+    uint8_t    seg[6];
+    uint8_t    back = mpx_front ^ 1;
+    mpx_digit *p    = mpx_img[back];
+
+    if (eeprom_read_config(EEADR_MENU_ITEM(db)) && menu_is_idle && 
+        !ALARM_STATUS && !timer_running(blank_tmr))
+         mpx_set_duty(0); // blank display
+    else mpx_set_duty((uint8_t)eeprom_read_config(EEADR_MENU_ITEM(dI)));
+    if (mpx_buf != mpx_front) return; // multiplexer() still uses the back buffer
+    if (!pwr_on)
+    {   // Display OFF on dispay
+        seg[0] = LED_O;
+        seg[1] = seg[2] = LED_F;
+        seg[3] = seg[4] = seg[5] = LED_OFF;
+    } // if
+    else if (timer_running(lamp_tmr))
+    {	// 7-segment display test for 1 second
+        for (i = 0; i < 6; i++) seg[i] = LED_ON;
+    } // else if
+    else
+    {
+        seg[0] = top_10; seg[1] = top_1; seg[2] = top_01;
+        seg[3] = bot_10; seg[4] = bot_1; seg[5] = bot_01;
+    } // else
+    for (i = 0; i < 6; i++)
+    {
+        if (seg[i] != p[i].seg) mpx_build(&p[i], seg[i]);
+    } // for
+    mpx_front = back; // multiplexer() uses this buffer from its next frame
+} // display_publish()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This routine multiplexes the 6 segments of the 7-segment displays.
              It runs at 1 kHz, so full update frequency is 166 Hz.
+             It only reads the front buffer with port-bits made by
+             display_publish(), so only port-writes are done here.
+             When the display is blanked (mpx_duty == 0), no digit is 
+             switched on. A reduced duty-cycle is made by the TMR2 compare
+             interrupt, see mpx_set_duty().
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 void multiplexer(void)
 {
-    // Disable all 7-segment LEDs and common-cathode pins
-    // PD7 PG1 PG0 PD4 PD3 PD2 PE0 PD0
-    //  D   E   F   G   dp  A   C   B 
-    PG_ODR    &= ~PG_SEG7; // Clear LEDs
-    PD_ODR    &= ~PD_SEG7; // Clear LEDs
-    PE_ODR    &= ~PE_SEG7; // Clear LEDs
-    PC_ODR    |=  PC_CC;   // Disable common-cathodes top-display
-    PE_ODR    |=  PE_CC;   // Disable common-cathodes bottom-display
+    mpx_digit *p;
+    uint8_t    nr = mpx_nr;
     
-    switch (mpx_nr)
-    {
-        case 0: // output 10s digit top display
-            PG_ODR |= ((top_10 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (top_10 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((top_10 >> 1) & PE_SEG7); // Update 7-segment C
-            PC_ODR &= ~CC1;    // Enable  common-cathode for 10s
-            mpx_nr = 1;
-            break;
-        case 1: // output 1s digit top display
-            PG_ODR |= ((top_1 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (top_1 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((top_1 >> 1) & PE_SEG7); // Update 7-segment C
-            PC_ODR &= ~CC2;    // Enable  common-cathode for 1s
-            mpx_nr = 2;
-            break;
-        case 2: // output 01s digit top display
-            PG_ODR |= ((top_01 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (top_01 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((top_01 >> 1) & PE_SEG7); // Update 7-segment C
-            PC_ODR &= ~CC3;    // Enable common-cathode for 0.1s
-            mpx_nr = 3;
-            break;
-        case 3: // outputs 10s digit bottom display
-            PG_ODR |= ((bot_10 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (bot_10 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((bot_10 >> 1) & PE_SEG7); // Update 7-segment C
-            PE_ODR &= ~CC4;     // Enable common-cathode for 10s
-            mpx_nr = 4;
-            break;
-        case 4: // outputs 1s digit bottom display
-            PG_ODR |= ((bot_1 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (bot_1 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((bot_1 >> 1) & PE_SEG7); // Update 7-segment C
-            PE_ODR &= ~CC5;     // Enable common-cathode for 10s
-            mpx_nr = 5;
-            break;
-        case 5: // outputs 0.10 digit bottom display
-            PG_ODR |= ((bot_01 >> 5) & PG_SEG7); // Update 7-segment E+F
-            PD_ODR |= (bot_01 & PD_SEG7);        // Update 7-segments
-            PE_ODR |= ((bot_01 >> 1) & PE_SEG7); // Update 7-segment C
-            PE_ODR &= ~CC6;     // Enable common-cathode for 0.1s
-        default: // FALL-THROUGH (less code-size)
-            mpx_nr = 0;
-            break;
-    } // switch            
+    if (nr == 0) mpx_buf = mpx_front; // switch buffers at start of frame
+    if (++mpx_nr > 5) mpx_nr = 0;
+    // Disable all 7-segment LEDs and common-cathode pins
+    PC_ODR |= PC_CC;                           // Disable common-cathodes top-display
+    PE_ODR  = (PE_ODR & ~PE_SEG7) | PE_CC;     // Clear LED, disable common-cathodes bottom-display
+    if (mpx_duty == 0) return;                 // Display blanked, leave all digits off
+    p = &mpx_img[mpx_buf][nr];
+    PG_ODR  = (PG_ODR & ~PG_SEG7) | p->pg;     // Update 7-segment E+F
+    PD_ODR  = (PD_ODR & ~PD_SEG7) | p->pd;     // Update 7-segments
+    PE_ODR  = (PE_ODR | p->pe) & mpx_pe_cc[nr]; // Update 7-segment C, bottom common-cathode
+    PC_ODR &= mpx_pc_cc[nr];                   // Enable common-cathode top-display
 } // multiplexer()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This is the interrupt routine for the Timer 2 Overflow handler.
-             It runs at 1 kHz and drives the scheduler and the multiplexer.
-             Measured timing: 1.0 msec and 9 usec duration (9.1 %).
+             It runs at 1 kHz and drives the scheduler, the multiplexer and 
+             the key scanner.
+             With SCHED_FOREGROUND, the scheduler runs in dispatch_tasks().
+             The display values are not touched here, see display_publish().
+             Duration and load are measured with ISR_ENTER()/ISR_EXIT(),
+             see UART command s7.
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
 #pragma vector=TIM2_OVR_UIF_vector
 __interrupt void TIM2_UPD_OVF_IRQHandler(void)
 {
-    PA_ODR |= ISR_OUT; // Time-measurement interrupt routine
-    t2_millis++;       // update millisecond counter
+    ISR_ENTER();       // Time-measurement interrupt routine
+    time_tick();       // update millisecond counter
+#if !SCHED_FOREGROUND
     scheduler_isr();   // Run scheduler interrupt function
-    
-    if (!pwr_on)
-    {   // Display OFF on dispay
-        top_10 = LED_O;
-        top_1  = top_01 = LED_F;
-        bot_10 = bot_1 = bot_01 = LED_OFF;
-        pwr_on_tmr = 1000; // 1 second
-    } // if
-    else if (pwr_on_tmr > 0)
-    {	// 7-segment display test for 1 second
-        pwr_on_tmr--;
-        top_10 = top_1 = top_01 = LED_ON;
-        bot_10 = bot_1 = bot_01 = LED_ON;
-    } // else if
-    multiplexer();        // Run multiplexer for Display
-    PA_ODR   &= ~ISR_OUT; // Time-measurement interrupt routine
+#endif
+    multiplexer();     // Run multiplexer for Display
+    key_scan();        // Debounce keys, key events for key_task()
     TIM2_SR1_UIF = 0;     // Reset interrupt (UIF bit) so it will not fire again straight away.
+    ISR_EXIT(ISR_TMR2);   // Time-measurement interrupt routine
 } // TIM2_UPD_OVF_IRQHandler()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This is the interrupt routine for the Timer 2 Compare 1 handler.
+             It is only enabled with a reduced duty-cycle (menu item dI) and
+             switches off the digit that was switched on by multiplexer() at
+             the start of this TMR2 period. Channel 1 is not connected to its
+             pin (CC1E = 0), so PD4 (segment G) remains a normal output.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+#pragma vector=TIM2_CAPCOM_CC1IF_vector
+__interrupt void TIM2_CAPCOM_IRQHandler(void)
+{
+    PC_ODR |= PC_CC;      // Disable common-cathodes top-display
+    PE_ODR |= PE_CC;      // Disable common-cathodes bottom-display
+    TIM2_SR1_CC1IF = 0;   // Reset interrupt (CC1IF bit)
+} // TIM2_CAPCOM_IRQHandler()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine initialises the system clock to run at 16 MHz.
              It uses the internal HSI oscillator.
@@ -206,6 +285,22 @@ void setup_timer2(void)
     TIM2_CR1_CEN = 1;    //  Finally enable the timer
 } // setup_timer2()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This routine sets the software priorities of the interrupts,
+             see PRIO_* in w3230_main.h. The UART RX interrupt gets the 
+             highest level, so it can interrupt the TMR2 interrupt and no
+             received bytes are lost. Call with interrupts disabled.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void setup_interrupt_priorities(void)
+{
+    ITC_SPR4 = (ITC_SPR4 & ~0x3C) | (PRIO_TIM2_CC << 4)     // IRQ14 in bits 5..4
+                                  | (PRIO_TIM2    << 2);    // IRQ13 in bits 3..2
+    ITC_SPR6 = (ITC_SPR6 & ~0x0F) | (PRIO_UART_RX << 2)     // IRQ21 in bits 3..2
+                                  |  PRIO_UART_TX;          // IRQ20 in bits 1..0
+} // setup_interrupt_priorities()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This routine initialises all the GPIO pins of the STM8 uC.
              See header-file for a pin-connections and functions.
@@ -309,22 +404,50 @@ void pid_to_time(void)
 } // pid_to_time()
 
 /*-----------------------------------------------------------------------------
-  Purpose  : This task is called every 100 msec. and reads the buttons, runs
-             the STD and updates the SSR slow-PWM from the PID-output.
+  Purpose  : This task runs every 100 msec. and when a key event is posted
+             by key_scan() (event EV_BUTTON). It runs the STD for every key
+             event and once more for the time-outs within the STD, so that
+             the display shows the result of a key press within a few msec.
+             A key press on a blanked display only wakes up the display.
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
-void std_task(void)
+void key_task(void)
 {
-    read_buttons(); // reads the buttons keys, result is stored in _buttons
+    if (key_pending())
+    {   // a key is pressed or released: restart timer for display blanking
+        if (mpx_duty == 0) key_wake = true; // blanked: not for menu_fsm()
+        timer_start(blank_tmr,TMR_NO_KEY_TIMEOUT,false);
+        while (key_event())
+        {
+            menu_fsm(); // Finite State Machine menu
+        } // while
+    } // if
+    key_held();     // no key changes, only time-outs
     menu_fsm();     // Finite State Machine menu
+    if (pwr_on && !pwr_on_old)
+    {   // Power switched on: 7-segment display test for 1 second
+        timer_start(lamp_tmr,1000,false);
+    } // if
+    pwr_on_old = pwr_on;
+    display_publish(); // show new display values
+} // key_task()
+
+/*-----------------------------------------------------------------------------
+  Purpose  : This task is called every 100 msec. and updates the SSR slow-PWM
+             from the PID-output.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void std_task(void)
+{
     pid_to_time();  // Make Slow-PWM signal and send to SSR output-port
 } // std_task()
 
 /*-----------------------------------------------------------------------------
   Purpose  : This task is called every second and contains the main control
              task for the device. It also calls temperature_control() / 
-             pid_ctrl() and one_wire_task().
+             pid_ctrl().
   Variables: -
   Returns  : -
   ---------------------------------------------------------------------------*/
@@ -429,7 +552,7 @@ void ctrl_task(void)
            show_sa_alarm = !show_sa_alarm;
        } // if
    } // else
-   one_wire_task(); // read from one-wire temperature sensor
+   display_publish(); // show new display values
 } // ctrl_task()
 
 /*-----------------------------------------------------------------------------
@@ -445,7 +568,7 @@ void prfl_task(void)
         
     // Logging to ESP8266
     sprintf(s2,"l%d %d %d %d %d\n",std_tc,temp_ntc1,temp_ntc2,temp1_ow_10,setpoint);
-    xputs(s2);
+    xputs_policy(s2, TX_LOG_POLICY); // never wait for the UART
     if (++min >= 60)
     {   // call every hour
         min = 0;
@@ -460,31 +583,77 @@ void prfl_task(void)
 	     fractional bits (1/2, 1/4, 1/8, 1/16), a signed Q8.4 format
 	     would be sufficient. 
 	     This task is called every second so that every 2 seconds a new
-	     temperature is present.
+	     temperature is present. It is a coroutine: reading the result
+	     is split in 2 slices (see ds18b20_read_start() and 
+	     ds18b20_read_result()), so that other tasks (e.g. std_task) do
+	     not have to wait for the entire sequence.
   Variables: temp1_ow_84 : Temperature read from sensor in Q8.4 format
 			 temp1_ow_err: 1=error
   Returns  : -
   --------------------------------------------------------------------*/
 void one_wire_task(void)
 {
-    static int ow_std = 0; // internal state
+    static cr_state ow_cr  = 0; // resume point of coroutine
+    static uint8_t  ow_std = 0; // internal state
+    int16_t         temp;       // temperature in Q8.4 format
     
-    switch (ow_std)
-    {   
-        case 0: // Start Conversion
-            ds18b20_start_conversion(DS2482_ADDR);
-            ow_std = 1;
-            break;
-        case 1: // Read Thlt device
-            temp1_ow_10   = ds18b20_read(DS2482_ADDR, &temp1_ow_err,1);
-            temp1_ow_10  *= 5; // * 5/8 = 10/16
-            temp1_ow_10  += 4; // rounding
-            temp1_ow_10 >>= 3; // div 8
-            ow_std = 0;
-            break;
-    } // switch
+    CR_BEGIN(ow_cr);
+    if (ow_std == 0)
+    {   // Start Conversion
+        ds18b20_start_conversion(DS2482_ADDR);
+        ow_std = 1;
+    } // if
+    else
+    {   // Read temperature (only the 2 temperature bytes) from DS18B20
+        temp1_ow_err = !ds18b20_read_start(DS2482_ADDR); // false: error
+        temp         = 0;
+        if (!temp1_ow_err)
+        {
+            CR_YIELD(ow_cr);
+            temp = ds18b20_read_result(DS2482_ADDR, &temp1_ow_err, 1);
+        } // if
+        temp1_ow_10   = temp * 5; // * 5/8 = 10/16
+        temp1_ow_10  += 4; // rounding
+        temp1_ow_10 >>= 3; // div 8
+        ow_std = 0;
+    } // else
+    CR_END(ow_cr);
 } // one_wire_task()
 
+/*-----------------------------------------------------------------------------
+  Purpose  : This task runs when a line is received by the UART (event
+             EV_UART_LINE). It executes all received command lines. This is
+             a coroutine: a reply is sent one row at a time and the task 
+             yields until a row (REPLY_ROW_MAX bytes) fits in the transmit
+             buffer, so it never waits for the UART.
+  Variables: -
+  Returns  : -
+  ---------------------------------------------------------------------------*/
+void rs232_task(void)
+{
+    static cr_state rs2_cr = 0; // resume point of coroutine
+    static uint8_t  row;        // row of the reply
+    static uint8_t  rval;       // result of rs232_command_handler()
+    
+    CR_BEGIN(rs2_cr);
+    while (uart_line_ready())
+    {
+        row = 0;
+        do
+        {
+            while (uart_write_room() < REPLY_ROW_MAX) CR_YIELD(rs2_cr);
+            rval = rs232_command_handler(row++); // next row of one received line
+            switch (rval)
+            {
+                case ERR_CMD: xputs("Cmd Error\n"); break;
+                case ERR_NUM: xputs("Num Error\n");  break;
+                default     : break;
+            } // switch
+        } while (rval == CMD_MORE);
+    } // while
+    CR_END(rs2_cr);
+} // rs232_task()
+
 /*-----------------------------------------------------------------------------
   Purpose  : This is the main entry-point for the entire program.
              It initialises everything, starts the scheduler and dispatches
@@ -495,21 +664,39 @@ void one_wire_task(void)
 int main(void)
 {
     int8_t  ok;
+    uint8_t h; // task handle
     
     __disable_interrupt();
     initialise_system_clock(); // Set system-clock to 16 MHz
     setup_gpio_ports();        // Init. needed output-ports for LED and keys
     setup_timer2();            // Set Timer 2 to 1 kHz
+    setup_interrupt_priorities(); // UART RX highest, TMR2 lowest
+    delay_init();              // Calibrate delay-loops with Timer 2
     pwr_on = eeprom_read_config(EEADR_POWER_ON); // check pwr_on flag
     i2c_init_bb();             // Init. I2C bus
     uart_init();               // Init. serial communication
+    key_init();                // Init. key event queue
     
     // Initialise all tasks for the scheduler
     scheduler_init();                    // clear task_list struct
     add_task(adc_task ,"ADC",  0,  500); // every 500 msec.
     add_task(std_task ,"STD", 50,  100); // every 100 msec.
+    h = add_task(key_task,"KEY", 80, 100); // every 100 msec. and at every key event
+    bind_task_event(h, EV_BUTTON);
     add_task(ctrl_task,"CTL",200, 1000); // every second
     add_task(prfl_task,"PRF",300,60000); // every minute / hour
+    add_task(one_wire_task,"OWT",250,1000); // every second
+    h = add_task(rs232_task,"RS2",400, 1000); // every second and when a line is received
+    bind_task_event(h, EV_UART_LINE);
+#if SCHED_AUTO_PHASE
+    scheduler_stagger();                 // replace initial delays by calculated phases,
+    while (!scheduler_stagger_step()) ;  // at once: the tasks have not started yet
+    timer_start(timer_add(scheduler_stagger),5000,false); // again with measured durations, in chunks
+#endif
+    lamp_tmr = timer_add(NULL);          // 7-segment display test, started in key_task()
+    menu_tmr = timer_add(NULL);          // countdown timer for menu_fsm()
+    blank_tmr = timer_add(NULL);         // display blanking, restarted in key_task()
+    timer_start(blank_tmr,TMR_NO_KEY_TIMEOUT,false);
     __enable_interrupt();
     xputs(version); // print version number
     
@@ -520,12 +707,6 @@ int main(void)
 
     while (1)
     {   // background-processes
-        dispatch_tasks();     // Run task-scheduler()
-        switch (rs232_command_handler()) // run command handler continuously
-        {
-            case ERR_CMD: xputs("Cmd Error\n"); break;
-            case ERR_NUM: xputs("Num Error\n");  break;
-            default     : break;
-        } // switch
+        dispatch_tasks();     // Run task-scheduler(), sleeps when idle
     } // while
 } // main()
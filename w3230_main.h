@@ -215,18 +215,48 @@
 #define LED_u	(0xC2) 
 #define LED_y	(0xB3)
 
+// Port-bits of one 7-segment digit, used by multiplexer()
+typedef struct _mpx_digit
+{
+    uint8_t seg; // 7-segment value (LED_*) these port-bits were made from
+    uint8_t pg;  // bits for PG_ODR (PG_SEG7)
+    uint8_t pd;  // bits for PD_ODR (PD_SEG7)
+    uint8_t pe;  // bits for PE_ODR (PE_SEG7)
+} mpx_digit;
+
+// Duty-cycle of the 7-segment displays (menu item dI). TMR2 compare channel 1
+// switches a digit off after MPX_DUTY_US usec. per duty-cycle step.
+#define MPX_DUTY_MAX (8)                   /* 100 % duty-cycle, no blanking */
+#define MPX_DUTY_US  (1000 / MPX_DUTY_MAX) /* 125 usec. per step of a 1 msec. slot */
+
+// Software priorities of the interrupts (ITC_SPRx bits). Level 3 is the highest,
+// an interrupt with a higher level interrupts one with a lower level.
+#define ITC_LEVEL1   (0x01)
+#define ITC_LEVEL2   (0x00)
+#define ITC_LEVEL3   (0x03)
+#define PRIO_TIM2    (ITC_LEVEL1) /* IRQ13: TMR2 update/overflow */
+#define PRIO_TIM2_CC (ITC_LEVEL1) /* IRQ14: TMR2 capture/compare, display blanking */
+#define PRIO_UART_TX (ITC_LEVEL2) /* IRQ20: UART2 TX */
+#define PRIO_UART_RX (ITC_LEVEL3) /* IRQ21: UART2 RX, never wait for other interrupts */
+
 // Function prototypes
 void save_display_state(void);
 void restore_display_state(void);
+void mpx_build(mpx_digit *p, uint8_t seg);
+void mpx_set_duty(uint8_t duty);
+void display_publish(void);
 void multiplexer(void);
 void initialise_system_clock(void);
 void initialise_timer2(void);
 void setup_timer2(void);
+void setup_interrupt_priorities(void);
 void setup_gpio_ports(void);
 void adc_task(void);
+void key_task(void);
 void std_task(void);
 void ctrl_task(void);
 void prfl_task(void);
 void one_wire_task(void);
+void rs232_task(void);
 
 #endif // __STC1000P_H__